@@ -0,0 +1,88 @@
+/*
+ * File:   cpu.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+extern "C" {
+// the function ccp_write_io() was not declared with C linkage
+#include <avr/cpufunc.h>
+}
+
+#include "cpu.hpp"
+
+/**
+ * Gets the main clock prescaler setting of a division.
+ * @return The MCLKCTRLB value, or 0xFF if the prescaler cannot divide by it.
+ */
+constexpr uint8_t prescaler(uint8_t division) {
+    switch (division) {
+        case 1: return 0; // PEN = 0 (prescaler disabled)
+        case 2: return CLKCTRL_PDIV_2X_gc | CLKCTRL_PEN_bm;
+        case 4: return CLKCTRL_PDIV_4X_gc | CLKCTRL_PEN_bm;
+        case 6: return CLKCTRL_PDIV_6X_gc | CLKCTRL_PEN_bm;
+        case 8: return CLKCTRL_PDIV_8X_gc | CLKCTRL_PEN_bm;
+        case 10: return CLKCTRL_PDIV_10X_gc | CLKCTRL_PEN_bm;
+        case 12: return CLKCTRL_PDIV_12X_gc | CLKCTRL_PEN_bm;
+        case 16: return CLKCTRL_PDIV_16X_gc | CLKCTRL_PEN_bm;
+        case 24: return CLKCTRL_PDIV_24X_gc | CLKCTRL_PEN_bm;
+        case 32: return CLKCTRL_PDIV_32X_gc | CLKCTRL_PEN_bm;
+        case 48: return CLKCTRL_PDIV_48X_gc | CLKCTRL_PEN_bm;
+        case 64: return CLKCTRL_PDIV_64X_gc | CLKCTRL_PEN_bm;
+        default: return 0xFF;
+    }
+}
+
+constexpr uint8_t MAIN_CLOCK_PRESCALER = prescaler(cpu::CLOCK_DIVISION);
+
+static_assert(MAIN_CLOCK_PRESCALER != 0xFF
+    && cpu::OSCILLATOR_HZ / cpu::CLOCK_DIVISION == F_CPU,
+    "F_CPU is not a division of the oscillator frequency");
+
+namespace cpu {
+
+    void setup_clock() {
+        // CLKSEL = 0 (OSC20M), the clock at reset
+        ccp_write_io((uint8_t*)&CLKCTRL.MCLKCTRLA, CLKCTRL_CLKSEL_OSC20M_gc);
+        // the prescaler takes effect at once
+        ccp_write_io((uint8_t*)&CLKCTRL.MCLKCTRLB, MAIN_CLOCK_PRESCALER);
+    }
+
+    void idle() {
+        cli();
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+
+    void irq_roundrobin() {
+        ccp_write_io((uint8_t*)&CPUINT_CTRLA, CPUINT_LVL0RR_bm);
+    }
+}
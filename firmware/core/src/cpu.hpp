@@ -1,5 +1,5 @@
 /* 
- * File:   utilities.hpp
+ * File:   cpu.hpp
  * Author: Gabriele Falcioni <foss.dev@falcioni.net>
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,58 +24,48 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifndef UTILITIES_HPP_DEFINED
-#define	UTILITIES_HPP_DEFINED
+#ifndef CPU_HPP_INCLUDED
+#define	CPU_HPP_INCLUDED
 
 #include <stdint.h>
 
-class str_builder {
-
-private:
-    char buf[48];
-    uint8_t len;
-
-public:
-    inline str_builder() {
-        clear();
-    }
-
+namespace cpu {
     /**
-     * Gets the text contents.
-     * @return The text contents as a NUL-terminated C string.
+     * The frequency of the internal oscillator, selected by the FREQSEL fuse
+     * (20 MHz by default, 16 MHz otherwise).
      */
-    inline const char* text() {
-        return buf;
-    }
+#ifdef OSC_HZ
+    constexpr uint32_t OSCILLATOR_HZ = OSC_HZ;
+#else
+    constexpr uint32_t OSCILLATOR_HZ = 20000000;
+#endif
 
     /**
-     * Gets the text size.
-     * @return The text size.
+     * The division of the oscillator frequency that yields F_CPU,
+     * the clock profile selected at build time:
+     * - F_CPU=10000000, full speed: the fastest clock within the
+     *   specifications of the part at 3.3 V (20 MHz / 2);
+     * - F_CPU=3333333, low power: the clock at reset (20 MHz / 6).
+     * All the peripheral periods are derived from F_CPU.
      */
-    inline uint8_t length() {
-        return len;
-    }
+    constexpr uint8_t CLOCK_DIVISION = (OSCILLATOR_HZ + F_CPU / 2) / F_CPU;
 
     /**
-     * Clears the text content.
+     * Configures the main clock to run at F_CPU.
+     * Must be called before the peripherals are set up.
      */
-    void clear();
+    void setup_clock();
 
     /**
-     * Appends to current contents some text from PROGMEM.
-     * @param ptr A pointer to the text to append.
-     * @param size The size of the text to append.
+     * Puts the CPU to idle until the next interrupt.
      */
-    void append_progmem(const void *ptr, size_t size);
+    void idle();
 
     /**
-     * Appends to current contents an unsigned integer.
-     * The number is rendered in radix = 10.
-     * @param value The unsigned integer to append.
+     * Sets IRQ controller to serve IRQs with round-robin schedule.
      */
-    void append_uint(unsigned int value);
-
-};
+    void irq_roundrobin();
+}
 
-#endif	/* UTILITIES_HPP_DEFINED */
+#endif	/* CPU_HPP_INCLUDED */
 
@@ -0,0 +1,227 @@
+/* 
+ * File:   display.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "config.hpp"
+#include "display.hpp"
+#include "pins.hpp"
+#include "telemetry.hpp"
+
+/**
+ * The interval to keep a segment turned on, in milliseconds.
+ * Controls the timing of the segment multiplexer.
+ * A full refresh of the 8 segments lasts 8 intervals (125 Hz at 1 ms).
+ */
+constexpr uint16_t MUX_INTERVAL_MS = config::MUX_INTERVAL_MS;
+
+namespace drive {
+    /**
+     * The pins of the segments, in the order of the segment maps.
+     */
+    constexpr auto& PINS = config::SEGMENT_PINS;
+
+    constexpr uint8_t SEGMENTS = sizeof(PINS) / sizeof(PINS[0]);
+
+    static_assert(SEGMENTS == 8, "the segment maps have 8 bits");
+
+    /**
+     * The output values of PORTA and PORTB that light one segment.
+     */
+    struct levels {
+        uint8_t segment; // the bit of the segment in the segment maps
+        uint8_t a;
+        uint8_t b;
+    };
+
+    /**
+     * The output values of each segment, and the pins of all segments.
+     */
+    template <uint8_t N>
+    struct table {
+        levels segments[N];
+        uint8_t mask_a;
+        uint8_t mask_b;
+    };
+
+    template <uint8_t N>
+    constexpr table<N> make_table(const pins::pin (&map)[N]) {
+        table<N> result {};
+        for (uint8_t i = 0; i < N; ++i) {
+            const uint8_t bit = 1 << map[i].bit;
+            result.segments[i].segment = 1 << i;
+            if (map[i].out == pins::port::a) {
+                result.segments[i].a = bit;
+                result.mask_a |= bit;
+            } else {
+                result.segments[i].b = bit;
+                result.mask_b |= bit;
+            }
+        }
+        return result;
+    }
+
+    constexpr table<SEGMENTS> TABLE = make_table(PINS);
+
+    inline void none() {
+        PORTA.OUTCLR = TABLE.mask_a;
+        PORTB.OUTCLR = TABLE.mask_b;
+    }
+
+    inline void segment(const levels& out) {
+        none();
+        PORTA.OUTSET = out.a;
+        PORTB.OUTSET = out.b;
+    }
+}
+
+constexpr uint16_t tcb_top(uint16_t ms) { // assumes CLKSEL = CLK_PER/DIV2
+	return (uint16_t)((float)F_CPU * ms / 2000 + 0.5);
+}
+
+constexpr uint16_t MUX_TOP = tcb_top(MUX_INTERVAL_MS);
+
+constexpr uint16_t light_top(uint8_t level) {
+    return (uint32_t)MUX_TOP * (level + 1) / (display::MAX_BRIGHTNESS + 1);
+}
+
+static bool inited;
+static uint8_t current_segs; // not declared volatile since access is atomic and one-way (read or write, never both)
+static uint8_t mux_count;    // not declared volatile since access is not concurrent
+static bool mux_dark;        // true when the segment is in the dark part of its interval
+static volatile uint16_t mux_light_top;
+static volatile uint16_t mux_dark_top;
+
+ISR(TCB0_INT_vect) {
+    const uint16_t start = telemetry::enter();
+    // CAPT = 1 (INT cleared), periodic interrupt mode never clears it
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+
+    // when dimmed, each interval is split in a light and a dark part
+    if (mux_dark) {
+        mux_dark = false;
+        if (mux_dark_top) {
+            drive::none();
+            TCB0.CCMP = mux_dark_top;
+            telemetry::leave(telemetry::isr::mux, start);
+            return;
+        }
+        TCB0.CCMP = MUX_TOP;
+    } else if (mux_dark_top) {
+        TCB0.CCMP = mux_light_top;
+        mux_dark = true;
+    }
+
+    telemetry::mux_interval(start);
+    const drive::levels& out = drive::TABLE.segments[mux_count];
+    if (current_segs & out.segment) {
+        drive::segment(out);
+    } else {
+        drive::none();
+    }
+    mux_count = (mux_count + 1) & (drive::SEGMENTS - 1);
+    telemetry::leave(telemetry::isr::mux, start);
+}
+
+inline void setup_timer() {
+    // RUNSTDBY = 1, CLKSEL = 1 (CLK_PER/DIV2), ENABLE = 0 (disabled)
+    TCB0.CTRLA = TCB_RUNSTDBY_bm | TCB_CLKSEL_CLKDIV2_gc;
+    // CNTMODE = 0 (INT)
+    TCB0.CTRLB = 0x00;
+    // reset counter
+    TCB0.CNT = 0;
+    // TOP ~= 1 kHz
+    TCB0.CCMP = MUX_TOP;
+   // CAPT = 1 (INT cleared)
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+    // CAPT = 1 (INT enabled)
+    TCB0.INTCTRL = TCB_CAPT_bm;
+}
+
+inline void start_timer() {
+    // reset MUX state
+    mux_count = 0;
+    mux_dark = false;
+    telemetry::mux_restart();
+    // start timer
+    TCB0.CTRLA |= TCB_ENABLE_bm;
+}
+
+inline void stop_timer() {
+    // stop timer
+    TCB0.CTRLA &= ~TCB_ENABLE_bm;
+    // CAPT = 1 (INT cleared)
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+}
+
+namespace display {
+
+    void init() {
+        // ensure that initialisation is done once
+        if (inited) return;
+
+        PORTA.DIR |= drive::TABLE.mask_a; // set segment pins to outputs
+        PORTB.DIR |= drive::TABLE.mask_b;
+        drive::none(); // turn segments off
+
+        current_segs = 0;
+        mux_light_top = MUX_TOP;
+        mux_dark_top = 0;
+        setup_timer();
+
+        inited = true;
+    }
+
+    void off() {
+        current_segs = 0;
+        if (TCB0.STATUS) stop_timer();
+        drive::none();
+    }
+
+    void set_brightness(uint8_t level) {
+        if (level > MAX_BRIGHTNESS) level = MAX_BRIGHTNESS;
+        const uint16_t light = light_top(level);
+
+        cli();
+        mux_light_top = light;
+        mux_dark_top = MUX_TOP - light;
+        sei();
+    }
+
+    void show_char(char code) {
+        show_segments( char_to_segs(code) );
+    }
+
+    void show_segments(uint8_t map) {
+        if ((current_segs = map)) {
+            if (!TCB0.STATUS) start_timer();
+        } else {
+            if (TCB0.STATUS) stop_timer();
+        }
+    }
+
+}
@@ -42,6 +42,11 @@ namespace display {
         constexpr uint8_t dp = 0x80;
     }
 
+    /**
+     * The highest brightness level (all segments at full duty).
+     */
+    constexpr uint8_t MAX_BRIGHTNESS = 7;
+
     /**
      * Initialises the hardware resources related to the 7-seg display.
      * GPIO: PA6, PA7, PB0, PB1, PB2, PB3, PB4, PB5.
@@ -54,6 +59,15 @@ namespace display {
      */
     void off();
 
+    /**
+     * Sets the brightness of the display.
+     * Each segment interval is split in a light and a dark part.
+     * At level N, segments are lit for (N + 1) / 8 of their interval.
+     * @param level The brightness level, from 0 (dimmest) to MAX_BRIGHTNESS.
+     *              Greater values are clamped to MAX_BRIGHTNESS.
+     */
+    void set_brightness(uint8_t level);
+
     /**
      * Displays a character.
      * Supported character codes are displayed.
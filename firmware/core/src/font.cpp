@@ -1,5 +1,5 @@
 /* 
- * File:   display.cpp
+ * File:   font.cpp
  * Author: Gabriele Falcioni <foss.dev@falcioni.net>
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,57 +24,14 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <avr/io.h>
 #include <avr/pgmspace.h>
-#include <avr/interrupt.h>
 
 #include "display.hpp"
 
-/**
- * The interval to keep a segment turned on, in milliseconds.
- * Controls the timing of the segment multiplexer.
+/*
+ * The glyphs of the character codes, shared with the host tools
+ * which render what the modules display.
  */
-constexpr uint16_t MUX_INTERVAL_MS = 10;
-
-namespace drive {
-    inline void none() {
-        PORTA.OUTCLR = 0xC0;
-        PORTB.OUTCLR = 0x3F;
-    }
-    inline void a() {
-        none();
-        PORTB.OUTSET = 1 << 5;
-    }
-    inline void b() {
-        none();
-        PORTB.OUTSET = 1 << 4;
-    }
-    inline void c() {
-        none();
-        PORTB.OUTSET = 1 << 2;
-    }
-    inline void dp() {
-        none();
-        PORTB.OUTSET = 1 << 3;
-    }
-    inline void d() {
-        none();
-        PORTB.OUTSET = 1 << 1;
-    }
-    inline void e() {
-        none();
-        PORTB.OUTSET = 1 << 0;
-    }
-    inline void f() {
-        none();
-        PORTA.OUTSET = 1 << 7;
-    }
-    inline void g() {
-        none();
-        PORTA.OUTSET = 1 << 6;
-    }
-}
-
 namespace maps {
     using namespace display::segment;
 
@@ -150,96 +107,8 @@ namespace maps {
     };
 }
 
-static bool inited;
-static uint8_t current_segs; // not declared volatile since access is atomic and one-way (read or write, never both)
-static uint8_t mux_count;    // not declared volatile since access is not concurrent
-
-ISR(TCB0_INT_vect) {
-    if (current_segs & (1 << mux_count)) {
-        switch (mux_count) {
-            case 0: drive::a(); break;
-            case 1: drive::b(); break;
-            case 2: drive::c(); break;
-            case 3: drive::d(); break;
-            case 4: drive::e(); break;
-            case 5: drive::f(); break;
-            case 6: drive::g(); break;
-            case 7: drive::dp(); break;
-        }
-    } else {
-        drive::none();
-    }
-    mux_count = (mux_count + 1) & 0x07;
-}
-
-constexpr uint16_t tcb_top(uint16_t ms) { // assumes CLKSEL = CLK_PER/DIV2
-	return (uint16_t)((float)F_CPU * ms / 2000 + 0.5);
-}
-
-inline void setup_timer() {
-    // RUNSTDBY = 1, CLKSEL = 1 (CLK_PER/DIV2), ENABLE = 0 (disabled)
-    TCB0.CTRLA = TCB_RUNSTDBY_bm | TCB_CLKSEL_CLKDIV2_gc;
-    // CNTMODE = 0 (INT)
-    TCB0.CTRLB = 0x00;
-    // reset counter
-    TCB0.CNT = 0;
-    // TOP ~= 200 Hz
-    TCB0.CCMP = tcb_top(MUX_INTERVAL_MS);
-   // CAPT = 1 (INT cleared)
-    TCB0.INTFLAGS = TCB_CAPT_bm;
-    // CAPT = 1 (INT enabled)
-    TCB0.INTCTRL = TCB_CAPT_bm;
-}
-
-inline void start_timer() {
-    // reset MUX state
-    mux_count = 0;
-    // start timer
-    TCB0.CTRLA |= TCB_ENABLE_bm;
-}
-
-inline void stop_timer() {
-    // stop timer
-    TCB0.CTRLA &= ~TCB_ENABLE_bm;
-    // CAPT = 1 (INT cleared)
-    TCB0.INTFLAGS = TCB_CAPT_bm;
-}
-
 namespace display {
 
-    void init() {
-        // ensure that initialisation is done once
-        if (inited) return;
-
-        PORTA.DIR |= 0xC0; // set PORTA[6..7] to outputs
-        PORTA.OUT &= 0x3F; // turn segments off
-        PORTB.DIR |= 0x3F; // set PORTB[0..5] to outputs
-        PORTB.OUT &= 0xC0; // turn segments off
-
-        current_segs = 0;
-        setup_timer();
-
-        inited = true;
-    }
-
-    void off() {
-        current_segs = 0;
-        if (TCB0.STATUS) stop_timer();
-        drive::none();
-    }
-
-    void show_char(char code) {
-        show_segments( char_to_segs(code) );
-    }
-
-    void show_segments(uint8_t map) {
-        if ((current_segs = map)) {
-            if (!TCB0.STATUS) start_timer();
-        } else {
-            if (TCB0.STATUS) stop_timer();
-        }
-    }
-
     uint8_t char_to_segs(char code) {
         bool has_dp = (bool)(code & 0x80);
         uint8_t map = 0; // all segments off
@@ -255,10 +124,10 @@ namespace display {
             map = pgm_read_byte(maps::lower + (code - 'a'));
         } else switch (code) {
             case '-':
-                code = segment::g;
+                map = segment::g;
                 break;
             case '_':
-                code = segment::d;
+                map = segment::d;
                 break;
             case '.':
                 return segment::dp;
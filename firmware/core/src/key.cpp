@@ -32,28 +32,39 @@
 #include "timer.hpp"
 
 /**
- * The number of ticks whether the key state must be stable
- * to emit a key change event.
+ * The time in milliseconds whether the key state must be stable
+ * before a new key change is detected.
  */
-constexpr int8_t DEBOUNCE_TICKS = 2;
+constexpr uint16_t DEBOUNCE_MS = 5;
+
+constexpr uint16_t DEBOUNCE_COUNTS = (uint32_t)DEBOUNCE_MS * timer::COUNTS_PER_SEC / 1000;
+
+static_assert(DEBOUNCE_COUNTS > 0, "debounce interval shorter than the RTC resolution");
+static_assert(DEBOUNCE_MS < 1000 / timer::TICKS_PER_SEC, "debounce interval longer than a tick");
 
 /*
  * The mask of the GPIO pin connected to the key.
  */
 constexpr uint8_t PIN_MASK = 0x08;
 
+/*
+ * The size of the event queue, a power of two.
+ */
+constexpr uint8_t QUEUE_SIZE = 4;
+
 static bool inited;
-static volatile bool pressed;
-static volatile bool pressed_changed;
-static int8_t waiting_ticks;
-static uint8_t last_ticks;
+static volatile bool key_pressed;
+
+static key::event queue[QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
 
 inline bool get_state() {
     return PORTC.IN & PIN_MASK;
 }
 
 inline void enable_irq() {
-    if (pressed) {
+    if (key_pressed) {
         // INVEN = 1 (key -> GND when pressed), PULLUPEN = 1 (enabled), IRQ on falling edge
         PORTC.PIN3CTRL = PORT_INVEN_bm | PORT_PULLUPEN_bm | PORT_ISC_FALLING_gc;
     } else {
@@ -62,13 +73,34 @@ inline void enable_irq() {
     }
 }
 
+inline void push_event(uint16_t time) {
+    // the newest changes are lost when the queue is full
+    const uint8_t tail = queue_tail;
+    if ((uint8_t)(tail - queue_head) == QUEUE_SIZE) return;
+    queue[tail & (QUEUE_SIZE - 1)] = { key_pressed ? key::state_t::pressed : key::state_t::released, time };
+    queue_tail = tail + 1;
+}
+
+static void debounced() {
+    // an edge may have been missed while the IRQ was disabled
+    if (get_state() != key_pressed) {
+        key_pressed = !key_pressed;
+        push_event(timer::now());
+        timer::alarm(DEBOUNCE_COUNTS, debounced);
+        return;
+    }
+    enable_irq();
+}
+
 ISR(PORTC_PORT_vect) {
+    const uint16_t time = timer::now();
     // the key state depends on the change event configured for this IRQ
-    pressed = (PORTC.PIN3CTRL & PORT_ISC_gm) == PORT_ISC_RISING_gc;
-    // disable IRQ
+    key_pressed = (PORTC.PIN3CTRL & PORT_ISC_gm) == PORT_ISC_RISING_gc;
+    // disable IRQ until the key is stable
     PORTC.PIN3CTRL &= ~PORT_ISC_gm;
     PORTC.INTFLAGS = PIN_MASK;
-    pressed_changed = true;
+    push_event(time);
+    timer::alarm(DEBOUNCE_COUNTS, debounced);
 }
 
 namespace key {
@@ -85,43 +117,41 @@ namespace key {
         PORTC.INTFLAGS = PIN_MASK;
 
         // assumes that key state is stable
-        pressed = get_state();
+        key_pressed = get_state();
         enable_irq();
-        last_ticks = timer::ticks();
-        waiting_ticks = DEBOUNCE_TICKS;
 
         inited = true;
     }
 
-    bool changed() {
+    bool next(event& e) {
         cli();
-        const bool result = pressed_changed;
-        pressed_changed = false;
+        const uint8_t head = queue_head;
+        const bool result = head != queue_tail;
+        if (result) {
+            e = queue[head & (QUEUE_SIZE - 1)];
+            queue_head = head + 1;
+        }
         sei();
         return result;
     }
 
-    state_t state() {
-        return pressed ? state_t::pressed : state_t::released;
+    bool changed() {
+        event e;
+        bool result = false;
+        while (next(e)) result = true;
+        return result;
     }
 
-    void run() {
-        // do nothing (but update the tick counter) when any port IRQ is enabled
-        if (PORTC.PIN3CTRL & PORT_ISC_gm) {
-            last_ticks = timer::ticks();
-            return;
+    bool pressed() {
+        event e;
+        bool result = false;
+        while (next(e)) {
+            if (e.state == state_t::pressed) result = true;
         }
+        return result;
+    }
 
-        // after a key change is initiated by the key IRQ handler,
-        // wait for the specified number of ticks (the debounce interval)
-        const uint8_t ticks = timer::ticks();
-        const uint8_t elapsed = ticks - last_ticks;
-        last_ticks = ticks;
-
-        if ((waiting_ticks -= elapsed) > 0) return;
-
-        // if enough ticks have elapsed, enable the key change IRQ again
-        enable_irq();
-        waiting_ticks = DEBOUNCE_TICKS;
+    state_t state() {
+        return key_pressed ? state_t::pressed : state_t::released;
     }
 }
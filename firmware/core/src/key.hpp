@@ -27,6 +27,8 @@
 #ifndef KEY_HPP_INCLUDED
 #define	KEY_HPP_INCLUDED
 
+#include "timer.hpp"
+
 namespace key {
 
     enum class state_t: bool {
@@ -34,27 +36,44 @@ namespace key {
         pressed = true,
     };
 
+    /**
+     * A key change, timestamped when the edge is detected.
+     */
+    struct event {
+        state_t state;
+        uint16_t time; // @see timer::now()
+    };
+
     /**
      * Initialises the hardware resources related to the key.
      * GPIO: PC3.
+     * The key is debounced with the RTC alarm (@see timer::alarm()).
      */
     void init();
 
     /**
+     * Takes the oldest key change out of the event queue.
+     * @param e Receives the key change.
+     * @return true if there was a key change, false if the queue is empty.
+     */
+    bool next(event& e);
+
+    /**
+     * Empties the event queue.
      * @return true if the key has changed state since last check, false otherwise.
      */
     bool changed();
 
     /**
-     * @return Current key state.
+     * Empties the event queue.
+     * @return true if the key has been pressed since last check, false otherwise.
      */
-    state_t state();
+    bool pressed();
 
     /**
-     * Runs the key management algorithm.
-     * Call this function at each tick.
+     * @return Current key state.
      */
-    void run();
+    state_t state();
 }
 
 #endif	/* KEY_HPP_INCLUDED */
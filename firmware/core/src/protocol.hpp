@@ -0,0 +1,84 @@
+/* 
+ * File:   protocol.hpp
+ * Author: Gabriele Falcioni
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PROTOCOL_HPP_INCLUDED
+#define	PROTOCOL_HPP_INCLUDED
+
+#include <stdint.h>
+
+/**
+ * The serial protocol of the smart-display modules, shared by the firmware
+ * of the modules and by the ones that drive a chain, like the racing game.
+ * The commands are described with their handling (@see command.hpp).
+ */
+namespace protocol {
+
+    /**
+     * The command codes are contiguous and below the attribute codes
+     * (0x10-0x1F, @see effect::attribute), so that no unit is both.
+     */
+    namespace code {
+        constexpr uint8_t skip    = 0x01; // SKIP n: leaves n slots unchanged
+        constexpr uint8_t fill    = 0x02; // FILL n c: writes c to n slots
+        constexpr uint8_t write   = 0x03; // WRITE o c: writes c to the slot at offset o
+        constexpr uint8_t bright  = 0x04; // BRIGHT l: sets the brightness of all modules
+        constexpr uint8_t check   = 0x05; // CHECK crc: commits the writes if crc matches
+        constexpr uint8_t query   = 0x06; // QUERY k: each module appends a report of kind k
+        constexpr uint8_t report  = 0x07; // REPORT n ...: n units forwarded unchanged
+        constexpr uint8_t marquee = 0x08; // MARQUEE m: starts (1) or stops (0) the marquee mode
+        constexpr uint8_t store   = 0x09; // STORE s: saves the settings s of all modules
+        constexpr uint8_t segs    = 0x0A; // SEGS o m: shows the segments m on the slot at offset o
+        constexpr uint8_t sync    = 0x0B; // SYN h: restarts the timer, h modules ago
+    }
+
+    /**
+     * Gets the BAUD register value of the USART for a speed.
+     * @param bps The speed in bits per second.
+     * @return The BAUD value, in 1/64 of the CLK_PER cycles of a sample.
+     */
+    constexpr uint16_t uart_baud(uint16_t bps) {
+        // original formula from Microchip TB3216:
+        // return ( (F_CPU * 64 / (16 * (float)bps) + 0.5);
+        return (uint16_t)((float)F_CPU * 4 / bps + 0.5);
+    }
+
+    /**
+     * Updates the CRC-8 (polynomial 0x07, initial value 0) of the message
+     * units checked by CHECK, and of the records dumped by the racing game.
+     * @param crc The CRC of the previous units.
+     * @param unit The next unit.
+     * @return The CRC including the unit.
+     */
+    inline uint8_t crc8(uint8_t crc, uint8_t unit) {
+        crc ^= unit;
+        for (uint8_t i = 0; i < 8; ++i) {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+        return crc;
+    }
+}
+
+#endif	/* PROTOCOL_HPP_INCLUDED */
@@ -0,0 +1,127 @@
+/* 
+ * File:   telemetry.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+
+#include "telemetry.hpp"
+#include "timer.hpp"
+
+/**
+ * The number of CPU cycles in one second.
+ */
+constexpr uint32_t CYCLES_PER_SEC = F_CPU;
+
+struct window {
+    uint32_t sum;
+    uint16_t count;
+};
+
+static window windows[(uint8_t)telemetry::isr::count];
+static volatile uint16_t max_cycles[(uint8_t)telemetry::isr::count];
+
+static bool mux_valid;
+static uint16_t mux_last;
+static volatile uint16_t mux_min = 0xFFFF;
+static volatile uint16_t mux_max;
+
+static uint16_t last_second;
+static telemetry::report published;
+
+inline void setup_timer() {
+    // CNTMODE = 0 (INT), TOP = 0xFFFF: the counter wraps every 65536 cycles
+    TCB1.CTRLB = 0x00;
+    TCB1.CCMP = 0xFFFF;
+    TCB1.CNT = 0;
+    TCB1.INTCTRL = 0;
+    // RUNSTDBY = 1, CLKSEL = 0 (CLK_PER), ENABLE = 1
+    TCB1.CTRLA = TCB_RUNSTDBY_bm | TCB_CLKSEL_CLKDIV1_gc | TCB_ENABLE_bm;
+}
+
+namespace telemetry {
+
+    void init() {
+        if (ENABLED) setup_timer();
+    }
+
+    void record(isr id, uint16_t cycles) {
+        window& w = windows[(uint8_t)id];
+        w.sum += cycles;
+        ++w.count;
+        if (cycles > max_cycles[(uint8_t)id]) max_cycles[(uint8_t)id] = cycles;
+    }
+
+    void record_mux(uint16_t now) {
+        if (mux_valid) {
+            const uint16_t interval = now - mux_last;
+            if (interval < mux_min) mux_min = interval;
+            if (interval > mux_max) mux_max = interval;
+        }
+        mux_last = now;
+        mux_valid = true;
+    }
+
+    void mux_restart() {
+        mux_valid = false;
+    }
+
+    void run() {
+        if (!ENABLED) return;
+        const uint16_t second = timer::seconds();
+        if (second == last_second) return;
+        last_second = second;
+
+        report measures;
+        uint32_t busy = 0;
+        cli();
+        for (uint8_t i = 0; i < (uint8_t)isr::count; ++i) {
+            measures.handlers[i].max = max_cycles[i];
+            measures.handlers[i].avg = windows[i].count ? windows[i].sum / windows[i].count : 0;
+            busy += windows[i].sum;
+            windows[i].sum = 0;
+            windows[i].count = 0;
+        }
+        measures.mux_min = mux_min;
+        measures.mux_max = mux_max;
+        mux_min = 0xFFFF;
+        mux_max = 0;
+        sei();
+
+        // the main loop polls, so this is its share rather than idle time
+        measures.isr_free_percent = busy < CYCLES_PER_SEC ? 100 - busy * 100 / CYCLES_PER_SEC : 0;
+
+        cli();
+        published = measures;
+        sei();
+    }
+
+    report get_report() {
+        return published;
+    }
+
+}
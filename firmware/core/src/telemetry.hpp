@@ -0,0 +1,133 @@
+/* 
+ * File:   telemetry.hpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TELEMETRY_HPP_INCLUDED
+#define TELEMETRY_HPP_INCLUDED
+
+#include <avr/io.h>
+
+#include <stdint.h>
+
+#include "config.hpp"
+
+/**
+ * The cycle budgets of the IRQ handlers, measured with the CPU clock.
+ * IRQ handlers call enter() and leave() around their body. When telemetry
+ * is disabled, the calls are optimised away.
+ * A higher priority IRQ handler (USART RXC) may interrupt the others:
+ * its cycles are then counted by both.
+ */
+namespace telemetry {
+
+    /**
+     * Set for a diagnostic build (@see config.hpp).
+     */
+    constexpr bool ENABLED = config::TELEMETRY;
+
+    enum class isr: uint8_t {
+        rxc, // USART receive complete
+        tca, // protocol timeout
+        mux, // segment multiplexer
+        rtc, // ticks and seconds
+        count
+    };
+
+    struct cycles {
+        uint16_t max; // the longest run since startup
+        uint16_t avg; // the average run in the last second
+    };
+
+    struct report {
+        cycles handlers[(uint8_t)isr::count];
+        uint8_t isr_free_percent; // the time out of the IRQ handlers in the last second
+        uint16_t mux_min;         // the shortest multiplexer interval in the last second
+        uint16_t mux_max;         // the longest multiplexer interval in the last second
+    };
+
+    /**
+     * Initialises the hardware resources related to the telemetry.
+     * Timer B: TCB1 (free running at CLK_PER).
+     */
+    void init();
+
+    /**
+     * Records a run of an IRQ handler, @see leave().
+     */
+    void record(isr id, uint16_t cycles);
+
+    /**
+     * Records the beginning of a multiplexer interval, @see mux_interval().
+     */
+    void record_mux(uint16_t now);
+
+    /**
+     * Marks the beginning of an IRQ handler.
+     * @return The start timestamp to pass to leave().
+     */
+    inline uint16_t enter() {
+        return ENABLED ? TCB1.CNT : 0;
+    }
+
+    /**
+     * Marks the end of an IRQ handler.
+     * @param id The IRQ handler.
+     * @param start The timestamp returned by enter().
+     */
+    inline void leave(isr id, uint16_t start) {
+        if (ENABLED) record(id, TCB1.CNT - start);
+    }
+
+    /**
+     * Marks the beginning of a multiplexer interval.
+     * Called from the multiplexer IRQ handler.
+     * @param start The timestamp returned by enter().
+     */
+    inline void mux_interval(uint16_t start) {
+        if (ENABLED) record_mux(start);
+    }
+
+    /**
+     * Marks the start of the multiplexer timer,
+     * the interval since its last stop is not measured.
+     */
+    void mux_restart();
+
+    /**
+     * Publishes the measures of the last second.
+     * Call this function in the main loop.
+     */
+    void run();
+
+    /**
+     * Gets the measures published by run().
+     * May be called from an IRQ handler.
+     * @return The published measures.
+     */
+    report get_report();
+
+}
+
+#endif /* TELEMETRY_HPP_INCLUDED */
@@ -28,6 +28,7 @@
 #include <avr/interrupt.h>
 #include <util/delay.h>
 
+#include "cpu.hpp"
 #include "display.hpp"
 #include "key.hpp"
 #include "test.hpp"
@@ -163,6 +164,35 @@ namespace test {
         }
     }
 
+    static uint8_t timeouts_segments;
+
+    static void toggle_a() {
+        timeouts_segments ^= display::segment::a;
+        timer::call_after(7, toggle_a);
+    }
+
+    static void toggle_d() {
+        timeouts_segments ^= display::segment::d;
+        timer::call_after(11, toggle_d);
+    }
+
+    void timer_timeouts() {
+        constexpr uint8_t TOGGLE_G = 0x01;
+        timer::init();
+        display::init();
+        toggle_a();
+        toggle_d();
+        timer::signal_after(13, TOGGLE_G);
+        for(;;) {
+            if (timer::take_events(TOGGLE_G)) {
+                timeouts_segments ^= display::segment::g;
+                timer::signal_after(13, TOGGLE_G);
+            }
+            display::show_segments(timeouts_segments);
+            cpu::idle();
+        }
+    }
+
     void key_states() {
         display::init();
         timer::init();
@@ -173,7 +203,6 @@ namespace test {
             display::show_char('n');
         }
         for(;;) {
-            key::run();
             if (key::changed()) {
                 if (key::state() == key::state_t::pressed) {
                     display::show_segments(display::segment::d);
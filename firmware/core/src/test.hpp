@@ -35,6 +35,7 @@ namespace test {
     void timer_ticks();
     void timer_seconds();
     void timer_elapsed();
+    void timer_timeouts();
     void key_states();
 
 }
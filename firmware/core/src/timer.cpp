@@ -0,0 +1,333 @@
+/* 
+ * File:   timer.cpp
+ * Author: Gabriele Falcioni
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+#include "telemetry.hpp"
+#include "timer.hpp"
+
+static bool inited;
+static volatile uint16_t elapsed_ticks;
+static volatile uint16_t elapsed_secs;
+static volatile uint16_t elapsed_counts;
+
+static bool compare_enabled;
+static volatile bool compare_triggered;
+
+/**
+ * A timeout, which expires when the tick counter reaches its deadline.
+ */
+struct timeout {
+    uint16_t deadline;
+    timer::alarm_handler handler;
+    uint8_t events;
+};
+
+/*
+ * The timeouts: the first slot is the one of enable(),
+ * the others are taken by call_after() and signal_after().
+ */
+constexpr uint8_t ENABLE_SLOT = 0;
+constexpr uint8_t TIMEOUT_SLOTS = timer::MAX_TIMEOUTS + 1;
+
+static_assert(TIMEOUT_SLOTS <= 8, "the pending timeouts are a bit mask");
+
+static timeout timeouts[TIMEOUT_SLOTS];
+static volatile uint8_t pending_timeouts;  // a bit per slot
+static volatile uint16_t next_deadline;    // no pending timeout expires before
+static volatile uint8_t raised_events;
+
+static volatile timer::alarm_handler alarm_pending;
+
+/*
+ * A compare value beyond the RTC period never matches the counter.
+ */
+constexpr uint16_t ALARM_DISARMED = 0xFFFF;
+
+inline void set_alarm_compare(uint16_t compare) {
+    // wait until the previous write is synchronised
+    while (RTC.STATUS & RTC_CMPBUSY_bm) ;
+    RTC.CMP = compare;
+}
+
+/**
+ * Expires the timeouts that reached their deadline, then finds the next
+ * deadline. The IRQ handler only scans the slots at that deadline.
+ */
+static void expire_timeouts() {
+    const uint16_t now = elapsed_ticks;
+    for (uint8_t slot = 0; slot < TIMEOUT_SLOTS; ++slot) {
+        const uint8_t bit = 1 << slot;
+        if (!(pending_timeouts & bit) || !timer::reached(now, timeouts[slot].deadline)) continue;
+        pending_timeouts &= ~bit;
+        raised_events |= timeouts[slot].events;
+        // the handler may schedule this slot again
+        if (timeouts[slot].handler) timeouts[slot].handler();
+    }
+
+    uint16_t nearest = 0xFFFF;
+    for (uint8_t slot = 0; slot < TIMEOUT_SLOTS; ++slot) {
+        if (!(pending_timeouts & (1 << slot))) continue;
+        const uint16_t wait = timeouts[slot].deadline - now;
+        if (wait < nearest) nearest = wait;
+    }
+    next_deadline = now + nearest;
+}
+
+ISR(RTC_PIT_vect) {
+    const uint16_t start = telemetry::enter();
+    RTC.PITINTFLAGS = RTC_PI_bm;
+    ++elapsed_secs;
+    telemetry::leave(telemetry::isr::rtc, start);
+}
+
+ISR(RTC_CNT_vect) {
+    const uint16_t start = telemetry::enter();
+    const uint8_t flags = RTC.INTFLAGS;
+    RTC.INTFLAGS = flags;
+    if (flags & RTC_OVF_bm) {
+        elapsed_counts += timer::COUNTS_PER_TICK;
+        ++elapsed_ticks;
+        if (pending_timeouts && timer::reached(elapsed_ticks, next_deadline)) expire_timeouts();
+    }
+    if (flags & RTC_CMP_bm) {
+        const timer::alarm_handler handler = alarm_pending;
+        alarm_pending = nullptr;
+        if (handler) handler();
+        // the handler may set another alarm
+        if (!alarm_pending) set_alarm_compare(ALARM_DISARMED);
+    }
+    telemetry::leave(telemetry::isr::rtc, start);
+}
+
+inline void disable_secs_irq() {
+    RTC.PITINTCTRL = 0;
+}
+inline void enable_secs_irq() {
+    RTC.PITINTCTRL = RTC_PI_bm;
+}
+
+inline void disable_ticks_irq() {
+    RTC.INTCTRL = 0;
+}
+
+inline void enable_ticks_irq() {
+    RTC.INTCTRL = RTC_OVF_bm | RTC_CMP_bm;
+}
+
+constexpr uint16_t rtc_per(uint16_t nticks) {
+    // assumes CLK_RTC = 32.768 kHz and PRESCALER = DIV8 (4.096 kHz)
+	return (uint16_t)((float)4096 / nticks + 0.5);
+}
+
+static_assert(rtc_per(timer::TICKS_PER_SEC) + 1 == timer::COUNTS_PER_TICK, "RTC period mismatch");
+
+static void enable_expired() {
+    compare_triggered = true;
+}
+
+/**
+ * Schedules a timeout in a slot.
+ * Call it with the ticks IRQ disabled or from the RTC IRQ handler.
+ */
+static void schedule(uint8_t slot, uint16_t ticks, timer::alarm_handler handler, uint8_t events) {
+    if (ticks == 0) ticks = 1;
+    const uint16_t deadline = elapsed_ticks + ticks;
+    timeouts[slot] = { deadline, handler, events };
+    if (!pending_timeouts || (int16_t)(deadline - next_deadline) < 0) next_deadline = deadline;
+    pending_timeouts |= 1 << slot;
+}
+
+static timer::timeout_id schedule_free(uint16_t ticks, timer::alarm_handler handler, uint8_t events) {
+    timer::timeout_id id = timer::NO_TIMEOUT;
+    disable_ticks_irq();
+    for (uint8_t slot = ENABLE_SLOT + 1; slot < TIMEOUT_SLOTS; ++slot) {
+        if (pending_timeouts & (1 << slot)) continue;
+        schedule(slot, ticks, handler, events);
+        id = slot;
+        break;
+    }
+    enable_ticks_irq();
+    return id;
+}
+
+namespace timer {
+
+    void init() {
+        // ensure that initialisation is done once
+        if (inited) return;
+
+        cli();
+
+        // wait until all registers are synchronised
+        while (RTC.STATUS) ;
+        // frequency = 49.95 Hz (50 ticks are slightly slower than a second)
+        RTC.PER = rtc_per(TICKS_PER_SEC);
+        // restart counter
+        RTC.CNT = 0;
+        // no alarm
+        RTC.CMP = ALARM_DISARMED;
+        // clear interrupts
+        RTC.INTFLAGS = RTC_OVF_bm | RTC_CMP_bm;
+        // enable interrupts
+        RTC.INTCTRL = RTC_OVF_bm | RTC_CMP_bm;
+        // RUNSTDBY = 1 (run in sleep mode), PRESCALER = DIV8 (4.096 kHz), RTCEN = 1 (enabled)
+        RTC.CTRLA = RTC_RUNSTDBY_bm | RTC_PRESCALER_DIV8_gc | RTC_RTCEN_bm;
+
+        // wait until all registers are synchronised
+        while (RTC.PITSTATUS) ;
+        // clear interrupts
+        RTC.PITINTFLAGS = RTC_PI_bm;
+        // enable interrupts
+        RTC.PITINTCTRL = RTC_PI_bm;
+        // PERIOD = RTC_CLK/32768 (1 Hz), PITEN = 1 (enabled)
+        RTC.PITCTRLA = RTC_PERIOD_CYC32768_gc | RTC_PITEN_bm;
+
+        sei();
+
+        inited = true;
+    }
+
+    void reset() {
+        compare_enabled = false;
+        disable_ticks_irq();
+        pending_timeouts = 0;
+        raised_events = 0;
+        elapsed_ticks = 0;
+        elapsed_counts = 0;
+        enable_ticks_irq();
+        disable_secs_irq();
+        elapsed_secs = 0;
+        enable_secs_irq();
+    }
+
+    void sync(uint32_t advance_us) {
+        // the RTC counts at 4.096 kHz and overflows after PER + 1 counts
+        const uint32_t counts = (advance_us * 512 + 62500) / 125000;
+        const uint16_t period = RTC.PER + 1;
+        const uint16_t ticks = counts / period;
+
+        disable_ticks_irq();
+        // the timeouts keep the same number of remaining ticks
+        const uint16_t shift = ticks - elapsed_ticks;
+        for (uint8_t slot = 0; slot < TIMEOUT_SLOTS; ++slot) timeouts[slot].deadline += shift;
+        next_deadline += shift;
+        elapsed_ticks = ticks;
+        elapsed_counts = ticks * period;
+        // wait until the counter can be written
+        while (RTC.STATUS & RTC_CNTBUSY_bm) ;
+        RTC.CNT = counts % period;
+        RTC.INTFLAGS = RTC_OVF_bm;
+        enable_ticks_irq();
+    }
+
+    uint8_t ticks() {
+        return (uint8_t)elapsed_ticks;
+    }
+
+    uint16_t now() {
+        const uint16_t counts = RTC.CNT;
+        uint16_t time = elapsed_counts + counts;
+        // the counter may have overflowed before its IRQ was served
+        if ((RTC.INTFLAGS & RTC_OVF_bm) && counts < COUNTS_PER_TICK / 2) time += COUNTS_PER_TICK;
+        return time;
+    }
+
+    uint16_t clock() {
+        cli();
+        const uint16_t time = now();
+        sei();
+        return time;
+    }
+
+    void alarm(uint16_t counts, alarm_handler handler) {
+        alarm_pending = handler;
+        set_alarm_compare((RTC.CNT + counts) % COUNTS_PER_TICK);
+    }
+
+    timeout_id call_after(uint16_t ticks, alarm_handler handler) {
+        return schedule_free(ticks, handler, 0);
+    }
+
+    timeout_id signal_after(uint16_t ticks, uint8_t events) {
+        return schedule_free(ticks, nullptr, events);
+    }
+
+    void cancel(timeout_id id) {
+        if (id == ENABLE_SLOT || id >= TIMEOUT_SLOTS) return;
+        disable_ticks_irq();
+        pending_timeouts &= ~(1 << id);
+        enable_ticks_irq();
+    }
+
+    uint8_t take_events(uint8_t mask) {
+        disable_ticks_irq();
+        const uint8_t events = raised_events & mask;
+        raised_events &= ~mask;
+        enable_ticks_irq();
+        return events;
+    }
+
+    uint16_t seconds() {
+        disable_secs_irq();
+        const uint16_t secs = elapsed_secs;
+        enable_secs_irq();
+        return secs;
+    }
+
+    void enable(uint8_t ticks) {
+        compare_enabled = true;
+        disable_ticks_irq();
+        compare_triggered = ticks == 0;
+        if (ticks) {
+            schedule(ENABLE_SLOT, ticks, enable_expired, 0);
+        } else {
+            pending_timeouts &= ~(1 << ENABLE_SLOT);
+        }
+        enable_ticks_irq();
+    }
+
+    void disable() {
+        compare_enabled = false;
+        disable_ticks_irq();
+        pending_timeouts &= ~(1 << ENABLE_SLOT);
+        enable_ticks_irq();
+    }
+
+    bool elapsed() {
+        return compare_enabled && compare_triggered;
+    }
+
+    uint8_t remaining_ticks() {
+        if (!compare_enabled || compare_triggered) return 0;
+        disable_ticks_irq();
+        const uint8_t remaining = timeouts[ENABLE_SLOT].deadline - elapsed_ticks;
+        enable_ticks_irq();
+        return remaining;
+    }
+}
@@ -0,0 +1,202 @@
+/* 
+ * File:   timer.hpp
+ * Author: Gabriele Falcioni
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TIMER_HPP_INCLUDED
+#define	TIMER_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "config.hpp"
+
+namespace timer {
+    /**
+     * The number of ticks in one second (@see config.hpp).
+     */
+    constexpr uint8_t TICKS_PER_SEC = config::TICKS_PER_SEC;
+
+    /**
+     * The number of RTC counts in one second, the resolution of the clock.
+     */
+    constexpr uint16_t COUNTS_PER_SEC = 4096;
+
+    /**
+     * The number of RTC counts in one tick: the counter overflows after
+     * the period rounded to the nearest count, plus one.
+     */
+    constexpr uint16_t COUNTS_PER_TICK = (COUNTS_PER_SEC + TICKS_PER_SEC / 2) / TICKS_PER_SEC + 1;
+
+    /**
+     * A function called when an alarm or a timeout goes off,
+     * from the RTC IRQ handler.
+     */
+    typedef void (*alarm_handler)();
+
+    /**
+     * The number of timeouts that may be pending at once,
+     * besides the one of enable() (@see call_after(), signal_after()).
+     */
+    constexpr uint8_t MAX_TIMEOUTS = 4;
+
+    /**
+     * Identifies a pending timeout, until it expires or is canceled.
+     */
+    typedef uint8_t timeout_id;
+
+    /**
+     * No timeout: all the slots are taken.
+     */
+    constexpr timeout_id NO_TIMEOUT = 0xFF;
+
+    /**
+     * Initialises the timer state and peripherals.
+     * The timer starts to count ticks and seconds.
+     */
+    void init();
+
+    /**
+     * Clears the timer state.
+     * All counters are resets to zero and the timeouts are canceled.
+     */
+    void reset();
+
+    /**
+     * Aligns the tick counter to an external event shared by several devices.
+     * The counter restarts from zero at the event, so it is set to the time
+     * elapsed since then. The timeout keeps its remaining ticks.
+     * The seconds counter is not affected.
+     * @param advance_us The time elapsed since the event in microseconds,
+     *                   less than 8 seconds.
+     */
+    void sync(uint32_t advance_us);
+
+    /**
+     * Gets the number of elapsed ticks.
+     * This counter is only 8-bit wide so it wraps around often.
+     * @return The number of elapsed ticks.
+     */
+    uint8_t ticks();
+
+    /**
+     * Gets the clock: the RTC counts elapsed since initialisation,
+     * restarted along with the tick counter by reset() and sync().
+     * It wraps around every 16 seconds (@see reached()).
+     * Call it from an IRQ handler or with interrupts disabled.
+     * @return The current time in RTC counts.
+     */
+    uint16_t now();
+
+    /**
+     * Gets the clock from the main loop (@see now()).
+     * @return The current time in RTC counts.
+     */
+    uint16_t clock();
+
+    /**
+     * Checks whether a time is at or after a deadline, across the clock
+     * wrap-around. The deadline must be less than 8 seconds away.
+     * @param time The time to check, in RTC counts.
+     * @param deadline The deadline, in RTC counts.
+     * @return true if the deadline is reached at that time, false otherwise.
+     */
+    constexpr bool reached(uint16_t time, uint16_t deadline) {
+        return (int16_t)(time - deadline) >= 0;
+    }
+
+    /**
+     * Calls a function after a delay shorter than a tick, in the RTC IRQ.
+     * Only one alarm may be pending, a new one replaces it.
+     * @param counts The delay in RTC counts (@see COUNTS_PER_SEC).
+     * @param handler The function to call.
+     */
+    void alarm(uint16_t counts, alarm_handler handler);
+
+    /**
+     * Calls a function after a number of ticks, in the RTC IRQ.
+     * The function may schedule other timeouts, itself included.
+     * @param ticks The number of ticks to wait, less than 32768;
+     *              0 expires at the next tick, like 1.
+     * @param handler The function to call.
+     * @return The timeout, or NO_TIMEOUT if MAX_TIMEOUTS are pending.
+     */
+    timeout_id call_after(uint16_t ticks, alarm_handler handler);
+
+    /**
+     * Raises event flags after a number of ticks (@see take_events()).
+     * The RTC IRQ also wakes the CPU, so a main loop may sleep
+     * until the events.
+     * @param ticks The number of ticks to wait, less than 32768;
+     *              0 expires at the next tick, like 1.
+     * @param events The event flags to raise, defined by the application.
+     * @return The timeout, or NO_TIMEOUT if MAX_TIMEOUTS are pending.
+     */
+    timeout_id signal_after(uint16_t ticks, uint8_t events);
+
+    /**
+     * Cancels a pending timeout.
+     * @param id The timeout, NO_TIMEOUT is ignored.
+     */
+    void cancel(timeout_id id);
+
+    /**
+     * Takes the event flags raised by the timeouts, which are cleared.
+     * @param mask The event flags to take.
+     * @return The event flags of the mask raised since they were last taken.
+     */
+    uint8_t take_events(uint8_t mask = 0xFF);
+
+    /**
+     * Gets the number of elapsed seconds.
+     * @return The number of elapsed seconds.
+     */
+    uint16_t seconds();
+
+    /**
+     * Configures and enables a timeout in the future, polled with elapsed().
+     * It does not take one of the MAX_TIMEOUTS slots.
+     * @param ticks The number of ticks to wait, 0 elapses at once.
+     */
+    void enable(uint8_t ticks);
+
+    /**
+     * Disables the timeout.
+     */
+    void disable();
+
+    /**
+     * Checks if the timeout timer has elapsed.
+     * A disabled timer never elapses.
+     * @return true if the timer has elapsed, false otherwise.
+     */
+    bool elapsed();
+
+    /**
+     * Gets the number of ticks remaining before the timeout timer elapses.
+     * @return The number of ticks remaining or 0 if elapsed or disabled.
+     */
+    uint8_t remaining_ticks();
+}
+
+#endif	/* TIMER_HPP_INCLUDED */
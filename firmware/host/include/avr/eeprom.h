@@ -1,5 +1,5 @@
-/*
- * File:   cpu.cpp
+/* 
+ * File:   eeprom.h
  * Author: Gabriele Falcioni <foss.dev@falcioni.net>
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,30 +24,35 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#ifndef HAL_AVR_EEPROM_H_INCLUDED
+#define HAL_AVR_EEPROM_H_INCLUDED
+
 #include <stdint.h>
 
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/sleep.h>
+/* EEPROM variables are kept in RAM for the lifetime of the process */
+#define EEMEM
 
-extern "C" {
-// the function ccp_write_io() was not declared with C linkage
-#include <avr/cpufunc.h>
+/* writes complete at once */
+inline bool eeprom_is_ready() {
+    return true;
 }
 
-#include "cpu.hpp"
+inline void eeprom_busy_wait() {}
+
+inline uint8_t eeprom_read_byte(const uint8_t* address) {
+    return *address;
+}
 
-namespace cpu {
+inline uint16_t eeprom_read_word(const uint16_t* address) {
+    return *address;
+}
 
-    void idle() {
-        cli();
-        sleep_enable();
-        sei();
-        sleep_cpu();
-        sleep_disable();
-    }
+inline void eeprom_update_byte(uint8_t* address, uint8_t value) {
+    *address = value;
+}
 
-    void irq_roundrobin() {
-        ccp_write_io((uint8_t*)&CPUINT_CTRLA, CPUINT_LVL0RR_bm);
-    }
+inline void eeprom_update_word(uint16_t* address, uint16_t value) {
+    *address = value;
 }
+
+#endif /* HAL_AVR_EEPROM_H_INCLUDED */
@@ -0,0 +1,241 @@
+/* 
+ * File:   io.h
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HAL_AVR_IO_H_INCLUDED
+#define HAL_AVR_IO_H_INCLUDED
+
+/*
+ * The peripherals of the tinyAVR 1-series used by the firmware,
+ * with the same names and register layout as the device headers.
+ */
+
+#include <stdint.h>
+
+#include "hal.hpp"
+
+typedef volatile uint8_t register8_t;
+typedef volatile uint16_t register16_t;
+
+typedef struct PORT_struct {
+    register8_t DIR;
+    hal::strobe_register<1, hal::strobe::set> DIRSET;
+    hal::strobe_register<2, hal::strobe::clear> DIRCLR;
+    hal::strobe_register<3, hal::strobe::toggle> DIRTGL;
+    register8_t OUT;
+    hal::strobe_register<1, hal::strobe::set> OUTSET;
+    hal::strobe_register<2, hal::strobe::clear> OUTCLR;
+    hal::strobe_register<3, hal::strobe::toggle> OUTTGL;
+    register8_t IN, INTFLAGS, PORTCTRL, reserved[5];
+    register8_t PIN0CTRL, PIN1CTRL, PIN2CTRL, PIN3CTRL;
+    register8_t PIN4CTRL, PIN5CTRL, PIN6CTRL, PIN7CTRL;
+} PORT_t;
+
+typedef struct USART_struct {
+    register8_t RXDATAL, RXDATAH;
+    hal::transmit_register TXDATAL;
+    register8_t TXDATAH;
+    register8_t STATUS, CTRLA, CTRLB, CTRLC;
+    register16_t BAUD;
+    register8_t CTRLD, DBGCTRL, EVCTRL, TXPLCTRL, RXPLCTRL;
+} USART_t;
+
+typedef struct TCA_SINGLE_struct {
+    register8_t CTRLA, CTRLB, CTRLC, CTRLD;
+    register8_t CTRLECLR, CTRLESET, CTRLFCLR, CTRLFSET;
+    register8_t EVCTRL, INTCTRL, INTFLAGS, DBGCTRL, TEMP;
+    register16_t CNT, PER, CMP0, CMP1, CMP2;
+} TCA_SINGLE_t;
+
+typedef union TCA_union {
+    TCA_SINGLE_t SINGLE;
+} TCA_t;
+
+typedef struct TCB_struct {
+    register8_t CTRLA, CTRLB, EVCTRL, INTCTRL;
+    register8_t INTFLAGS, STATUS, DBGCTRL, TEMP;
+    register16_t CNT, CCMP;
+} TCB_t;
+
+typedef struct RTC_struct {
+    register8_t CTRLA, STATUS, INTCTRL;
+    hal::flags_register INTFLAGS;
+    register8_t TEMP, DBGCTRL, CALIB, CLKSEL;
+    register16_t CNT, PER, CMP;
+    register8_t PITCTRLA, PITSTATUS, PITINTCTRL, PITINTFLAGS, PITDBGCTRL;
+} RTC_t;
+
+typedef struct CCL_struct {
+    register8_t CTRLA, SEQCTRL0, INTCTRL0, INTFLAGS;
+    register8_t LUT0CTRLA, LUT0CTRLB, LUT0CTRLC, TRUTH0;
+    register8_t LUT1CTRLA, LUT1CTRLB, LUT1CTRLC, TRUTH1;
+} CCL_t;
+
+typedef struct CPUINT_struct {
+    register8_t CTRLA, STATUS, LVL0PRI, LVL1VEC;
+} CPUINT_t;
+
+typedef struct PORTMUX_struct {
+    register8_t CTRLA, CTRLB, CTRLC, CTRLD;
+} PORTMUX_t;
+
+typedef struct CPU_struct {
+    register8_t CCP, SREG;
+} CPU_t;
+
+typedef struct CLKCTRL_struct {
+    register8_t MCLKCTRLA, MCLKCTRLB, MCLKLOCK, MCLKSTATUS;
+} CLKCTRL_t;
+
+extern PORT_t PORTA, PORTB, PORTC;
+extern USART_t USART0;
+extern TCA_t TCA0;
+extern TCB_t TCB0, TCB1;
+extern RTC_t RTC;
+extern CCL_t CCL;
+extern CPUINT_t CPUINT;
+extern PORTMUX_t PORTMUX;
+extern CPU_t CPU;
+extern CLKCTRL_t CLKCTRL;
+
+#define CPUINT_CTRLA CPUINT.CTRLA
+#define CPU_SREG CPU.SREG
+#define CPU_I_bm 0x80
+
+/* IRQ vectors, numbered as in the ATtiny3216 vector table */
+#define PORTA_PORT_vect_num 3
+#define PORTB_PORT_vect_num 4
+#define PORTC_PORT_vect_num 5
+#define RTC_CNT_vect_num 6
+#define RTC_PIT_vect_num 7
+#define TCA0_OVF_vect_num 8
+#define TCB0_INT_vect_num 13
+#define TCB1_INT_vect_num 14
+#define USART0_RXC_vect_num 27
+#define USART0_DRE_vect_num 28
+#define USART0_TXC_vect_num 29
+#define HAL_VECTORS 31
+
+/* PORT */
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN4_bm 0x10
+#define PIN5_bm 0x20
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+#define PORT_INVEN_bm 0x80
+#define PORT_PULLUPEN_bm 0x08
+#define PORT_ISC_gm 0x07
+#define PORT_ISC_INTDISABLE_gc 0x00
+#define PORT_ISC_BOTHEDGES_gc 0x01
+#define PORT_ISC_RISING_gc 0x02
+#define PORT_ISC_FALLING_gc 0x03
+#define PORTMUX_USART0_ALTERNATE_gc 0x01
+
+/* USART */
+#define USART_RXCIF_bm 0x80
+#define USART_TXCIF_bm 0x40
+#define USART_DREIF_bm 0x20
+#define USART_RXSIF_bm 0x10
+#define USART_ISFIF_bm 0x08
+#define USART_BDF_bm 0x02
+#define USART_WFB_bm 0x01
+#define USART_BUFOVF_bm 0x40
+#define USART_FERR_bm 0x04
+#define USART_PERR_bm 0x02
+#define USART_RXCIE_bm 0x80
+#define USART_TXCIE_bm 0x40
+#define USART_DREIE_bm 0x20
+#define USART_RXSIE_bm 0x10
+#define USART_ABEIE_bm 0x04
+#define USART_RXEN_bm 0x80
+#define USART_TXEN_bm 0x40
+#define USART_RXMODE_NORMAL_gc 0x00
+#define USART_RXMODE_CLK2X_gc 0x02
+#define USART_RXMODE_GENAUTO_gc 0x04
+#define USART_RXMODE_LINAUTO_gc 0x06
+#define USART_CHSIZE_8BIT_gc 0x03
+#define USART_PMODE_DISABLED_gc 0x00
+#define USART_PMODE_EVEN_gc 0x20
+#define USART_PMODE_ODD_gc 0x30
+
+/* TCA */
+#define TCA_SINGLE_CLKSEL_DIV1_gc 0x00
+#define TCA_SINGLE_CLKSEL_DIV16_gc 0x08
+#define TCA_SINGLE_ENABLE_bm 0x01
+#define TCA_SINGLE_OVF_bm 0x01
+
+/* TCB */
+#define TCB_RUNSTDBY_bm 0x40
+#define TCB_CLKSEL_CLKDIV1_gc 0x00
+#define TCB_CLKSEL_CLKDIV2_gc 0x02
+#define TCB_CLKSEL_CLKTCA_gc 0x04
+#define TCB_ENABLE_bm 0x01
+#define TCB_CAPT_bm 0x01
+#define TCB_CNTMODE_INT_gc 0x00
+
+/* CLKCTRL */
+#define CLKCTRL_CLKSEL_OSC20M_gc 0x00
+#define CLKCTRL_PEN_bm 0x01
+#define CLKCTRL_PDIV_2X_gc (0x00 << 1)
+#define CLKCTRL_PDIV_4X_gc (0x01 << 1)
+#define CLKCTRL_PDIV_8X_gc (0x02 << 1)
+#define CLKCTRL_PDIV_16X_gc (0x03 << 1)
+#define CLKCTRL_PDIV_32X_gc (0x04 << 1)
+#define CLKCTRL_PDIV_64X_gc (0x05 << 1)
+#define CLKCTRL_PDIV_6X_gc (0x08 << 1)
+#define CLKCTRL_PDIV_10X_gc (0x09 << 1)
+#define CLKCTRL_PDIV_12X_gc (0x0A << 1)
+#define CLKCTRL_PDIV_24X_gc (0x0B << 1)
+#define CLKCTRL_PDIV_48X_gc (0x0C << 1)
+
+/* RTC */
+#define RTC_RUNSTDBY_bm 0x80
+#define RTC_PRESCALER_DIV8_gc 0x18
+#define RTC_RTCEN_bm 0x01
+#define RTC_OVF_bm 0x01
+#define RTC_CMP_bm 0x02
+#define RTC_CNTBUSY_bm 0x02
+#define RTC_CMPBUSY_bm 0x08
+#define RTC_PI_bm 0x01
+#define RTC_PERIOD_CYC32768_gc 0x70
+#define RTC_PITEN_bm 0x01
+
+/* CCL */
+#define CCL_RUNSTDBY_bm 0x40
+#define CCL_ENABLE_bm 0x01
+#define CCL_OUTEN_bm 0x08
+#define CCL_INSEL0_MASK_gc 0x00
+#define CCL_INSEL0_USART0_gc 0x08
+#define CCL_INSEL1_MASK_gc 0x00
+#define CCL_INSEL2_MASK_gc 0x00
+#define CCL_INSEL2_IO_gc 0x05
+
+/* CPUINT */
+#define CPUINT_LVL0RR_bm 0x01
+
+#endif /* HAL_AVR_IO_H_INCLUDED */
@@ -1,5 +1,5 @@
 /* 
- * File:   cpu.hpp
+ * File:   sleep.h
  * Author: Gabriele Falcioni <foss.dev@falcioni.net>
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,20 +24,17 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifndef CPU_HPP_INCLUDED
-#define	CPU_HPP_INCLUDED
+#ifndef HAL_AVR_SLEEP_H_INCLUDED
+#define HAL_AVR_SLEEP_H_INCLUDED
 
-namespace cpu {
-    /**
-     * Puts the CPU to idle until the next interrupt.
-     */
-    void idle();
+#include "hal.hpp"
 
-    /**
-     * Sets IRQ controller to serve IRQs with round-robin schedule.
-     */
-    void irq_roundrobin();
-}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
 
-#endif	/* CPU_HPP_INCLUDED */
+/* waits for the next IRQ raised by the test bench */
+inline void sleep_cpu() {
+    hal::wait(0);
+}
 
+#endif /* HAL_AVR_SLEEP_H_INCLUDED */
@@ -0,0 +1,175 @@
+/* 
+ * File:   hal.hpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef HAL_HPP_INCLUDED
+#define HAL_HPP_INCLUDED
+
+#include <stdint.h>
+
+/**
+ * The host backend of the hardware abstraction layer.
+ * The firmware talks to the hardware through the avr-libc interface:
+ * <avr/io.h> and the other headers of this directory implement it
+ * on the host, so the firmware sources are built unchanged.
+ * Peripheral registers are plain memory: a test bench plays the part of
+ * the hardware, by setting the registers and raising the IRQs.
+ */
+namespace hal {
+
+    using handler = void (*)();
+    using time_hook = void (*)(uint32_t us);
+
+    /**
+     * Registers the handler of an IRQ vector.
+     * Called by the ISR() macro before main().
+     */
+    bool attach(uint8_t vector, handler isr);
+
+    /**
+     * Raises an IRQ, like the hardware would.
+     * The handler runs with interrupts disabled, as on the AVR core.
+     * @param vector The vector number (@see <avr/io.h>).
+     * @return true if the handler ran, false if interrupts are disabled
+     *         or no handler is attached.
+     */
+    bool raise(uint8_t vector);
+
+    /**
+     * Checks whether the global interrupt flag is set (@see sei(), cli()).
+     */
+    bool interrupts_enabled();
+
+    /**
+     * Sets the function called when the firmware waits for some time,
+     * with _delay_ms() or sleep_cpu(). The test bench may then advance
+     * its model of the hardware and raise IRQs.
+     * @param hook The function to call, or nullptr to return at once.
+     */
+    void on_wait(time_hook hook);
+
+    /**
+     * Called by the avr-libc functions that wait.
+     * @param us The time to wait in microseconds, 0 until the next IRQ.
+     */
+    void wait(uint32_t us);
+
+    /**
+     * Called when the firmware writes the TX data register of the USART.
+     * @param data The message unit to send.
+     */
+    void transmit(uint8_t data);
+
+    /**
+     * Takes the next unit written to the TX data register, if any.
+     * The test bench then shifts it out at the speed of the link.
+     * @param data Set to the unit sent by the firmware.
+     * @return true if a unit was written since the last call.
+     */
+    bool transmitted(uint8_t& data);
+
+    enum class strobe : uint8_t {
+        set,
+        clear,
+        toggle
+    };
+
+    /**
+     * A register that sets, clears or toggles the bits written to it
+     * in the register OFFSET bytes before, like DIRSET or OUTCLR.
+     * Reading it returns the target register, as on the device.
+     */
+    template <uint8_t OFFSET, strobe OP>
+    struct strobe_register {
+        volatile uint8_t unused;
+
+        volatile uint8_t& target() {
+            return *(reinterpret_cast<volatile uint8_t*>(this) - OFFSET);
+        }
+
+        strobe_register& operator=(uint8_t bits) {
+            switch (OP) {
+                case strobe::set: target() |= bits; break;
+                case strobe::clear: target() &= ~bits; break;
+                case strobe::toggle: target() ^= bits; break;
+            }
+            return *this;
+        }
+
+        strobe_register& operator|=(uint8_t bits) {
+            return *this = target() | bits;
+        }
+
+        operator uint8_t() {
+            return target();
+        }
+    };
+
+    /**
+     * The TX data register of the USART: each write sends a unit.
+     */
+    struct transmit_register {
+        volatile uint8_t data;
+
+        transmit_register& operator=(uint8_t unit) {
+            transmit(data = unit);
+            return *this;
+        }
+
+        operator uint8_t() {
+            return data;
+        }
+    };
+
+    /**
+     * An interrupt flags register: writing a one clears the bit,
+     * as on the device. The peripheral models raise the flags with set().
+     */
+    struct flags_register {
+        volatile uint8_t flags;
+
+        flags_register& operator=(uint8_t bits) {
+            flags &= ~bits;
+            return *this;
+        }
+
+        void set(uint8_t bits) {
+            flags |= bits;
+        }
+
+        operator uint8_t() {
+            return flags;
+        }
+    };
+
+    /**
+     * Clears all the registers and the global interrupt flag.
+     * The attached handlers are kept.
+     */
+    void reset();
+
+}
+
+#endif /* HAL_HPP_INCLUDED */
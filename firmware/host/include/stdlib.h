@@ -1,5 +1,5 @@
 /* 
- * File:   cpu.hpp
+ * File:   stdlib.h
  * Author: Gabriele Falcioni <foss.dev@falcioni.net>
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,20 +24,13 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifndef CPU_HPP_INCLUDED
-#define	CPU_HPP_INCLUDED
+#ifndef HAL_STDLIB_H_INCLUDED
+#define HAL_STDLIB_H_INCLUDED
 
-namespace cpu {
-    /**
-     * Puts the CPU to idle until the next interrupt.
-     */
-    void idle();
+#include_next <stdlib.h>
 
-    /**
-     * Sets IRQ controller to serve IRQs with round-robin schedule.
-     */
-    void irq_roundrobin();
-}
-
-#endif	/* CPU_HPP_INCLUDED */
+/* the conversions of avr-libc which are not standard */
+char* itoa(int value, char* buffer, int radix);
+char* utoa(unsigned value, char* buffer, int radix);
 
+#endif /* HAL_STDLIB_H_INCLUDED */
@@ -1,5 +1,5 @@
 /* 
- * File:   test.hpp
+ * File:   delay.h
  * Author: Gabriele Falcioni <foss.dev@falcioni.net>
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,19 +24,17 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifndef TEST_HPP_INCLUDED
-#define	TEST_HPP_INCLUDED
+#ifndef HAL_UTIL_DELAY_H_INCLUDED
+#define HAL_UTIL_DELAY_H_INCLUDED
 
-namespace test {
+#include "hal.hpp"
 
-    void all_segments();
-    void racing_segments();
-    void all_characters();
-    void timer_ticks();
-    void timer_seconds();
-    void timer_elapsed();
-    void key_states();
+inline void _delay_ms(double ms) {
+    hal::wait((uint32_t)(ms * 1000));
+}
 
+inline void _delay_us(double us) {
+    hal::wait((uint32_t)us);
 }
 
-#endif	/* TEST_HPP_INCLUDED */
+#endif /* HAL_UTIL_DELAY_H_INCLUDED */
@@ -0,0 +1,148 @@
+/* 
+ * File:   hal.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.hpp"
+
+PORT_t PORTA, PORTB, PORTC;
+USART_t USART0;
+TCA_t TCA0;
+TCB_t TCB0, TCB1;
+RTC_t RTC;
+CCL_t CCL;
+CPUINT_t CPUINT;
+PORTMUX_t PORTMUX;
+CPU_t CPU;
+CLKCTRL_t CLKCTRL;
+
+static hal::handler handlers[HAL_VECTORS];
+static hal::time_hook wait_hook;
+
+constexpr uint8_t TX_QUEUE_SIZE = 64; // must be a power of 2
+static uint8_t tx_queue[TX_QUEUE_SIZE];
+static uint8_t tx_head;
+static uint8_t tx_tail;
+
+void sei() {
+    CPU.SREG |= CPU_I_bm;
+}
+
+void cli() {
+    CPU.SREG &= ~CPU_I_bm;
+}
+
+static char* convert(unsigned long value, bool negative, char* buffer, int radix) {
+    char digits[sizeof(value) * 8];
+    int count = 0;
+    do {
+        const int digit = value % radix;
+        digits[count++] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= radix;
+    } while (value);
+
+    char* out = buffer;
+    if (negative) *out++ = '-';
+    while (count) *out++ = digits[--count];
+    *out = 0;
+    return buffer;
+}
+
+char* itoa(int value, char* buffer, int radix) {
+    const bool negative = value < 0 && radix == 10;
+    return convert(negative ? -(long)value : (unsigned)value, negative, buffer, radix);
+}
+
+char* utoa(unsigned value, char* buffer, int radix) {
+    return convert(value, false, buffer, radix);
+}
+
+namespace hal {
+
+    bool attach(uint8_t vector, handler isr) {
+        if (vector >= HAL_VECTORS) return false;
+        handlers[vector] = isr;
+        return true;
+    }
+
+    bool raise(uint8_t vector) {
+        if (vector >= HAL_VECTORS || !handlers[vector] || !interrupts_enabled()) return false;
+        cli();
+        handlers[vector]();
+        sei();
+        return true;
+    }
+
+    bool interrupts_enabled() {
+        return CPU.SREG & CPU_I_bm;
+    }
+
+    void on_wait(time_hook hook) {
+        wait_hook = hook;
+    }
+
+    void wait(uint32_t us) {
+        if (wait_hook) wait_hook(us);
+    }
+
+    void transmit(uint8_t data) {
+        const uint8_t next = (tx_head + 1) & (TX_QUEUE_SIZE - 1);
+        // a test bench that never takes the units drops the newest ones
+        if (next == tx_tail) return;
+        tx_queue[tx_head] = data;
+        tx_head = next;
+    }
+
+    bool transmitted(uint8_t& data) {
+        if (tx_tail == tx_head) return false;
+        data = tx_queue[tx_tail];
+        tx_tail = (tx_tail + 1) & (TX_QUEUE_SIZE - 1);
+        return true;
+    }
+
+    void reset() {
+        tx_head = tx_tail = 0;
+        memset((void*)&PORTA, 0, sizeof(PORTA));
+        memset((void*)&PORTB, 0, sizeof(PORTB));
+        memset((void*)&PORTC, 0, sizeof(PORTC));
+        memset((void*)&USART0, 0, sizeof(USART0));
+        memset((void*)&TCA0, 0, sizeof(TCA0));
+        memset((void*)&TCB0, 0, sizeof(TCB0));
+        memset((void*)&TCB1, 0, sizeof(TCB1));
+        memset((void*)&RTC, 0, sizeof(RTC));
+        memset((void*)&CCL, 0, sizeof(CCL));
+        memset((void*)&CPUINT, 0, sizeof(CPUINT));
+        memset((void*)&PORTMUX, 0, sizeof(PORTMUX));
+        memset((void*)&CPU, 0, sizeof(CPU));
+        memset((void*)&CLKCTRL, 0, sizeof(CLKCTRL));
+    }
+
+}
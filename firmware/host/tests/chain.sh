@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# Regression tests of the smart-display firmware on the chain test bench.
+# Each test sends its messages to a chain and expects a display among the
+# ones printed, at the end of each message or every sample (-t).
+# Run from firmware/host with: make check
+#
+
+CHAIN=${CHAIN:-build/chain}
+failures=0
+
+# expect NAME DISPLAY MESSAGES [CHAIN OPTIONS...]
+expect() {
+    name=$1
+    display=$2
+    messages=$3
+    shift 3
+    if printf '%s\n' "$messages" | "$CHAIN" "$@" | grep -qF "|$display|"; then
+        echo "PASS $name"
+    else
+        echo "FAIL $name: |$display| never displayed"
+        failures=$((failures + 1))
+    fi
+}
+
+expect forward-text ABCD '41 42 43 44' -f -n 4
+expect mirror-text ABCD '41 42 43 44' -n 4
+
+# SYN is a command: its operand is not a character
+expect forward-sync ABCD '0B 00 41 42 43 44' -f -n 4
+expect mirror-sync ABCD '41 42 43 44 0B' -n 4
+
+# a pulse at rate 1 (0x16) is an attribute, not a command: the whole text
+# follows it, lit an eighth of a period of 32 ticks
+expect forward-pulse ABCD '16 41 42 43 44' -f -n 4 -g 1000 -t 10
+
+# the text is shifted in from the first module, last character first
+expect forward-marquee ABCD "$(printf '08 01 44\n43\n42\n41')" -f -n 4
+
+# a MARQUEE dropped by a failed CHECK leaves the modules writing the text
+expect forward-dropped-marquee EFGH "$(printf '41 42 43 44\n08 01 5A 05 00\n45 46 47 48')" -f -n 4
+
+test $failures -eq 0
@@ -0,0 +1,17 @@
+#!/bin/sh
+#
+# Regression test of the racing game simulator: the default run must
+# report the crashes in more than one speed band, as the speed restarts
+# from the lowest after each crash.
+# Run from firmware/host with: make check
+#
+
+VMSIM=${VMSIM:-build/vmsim}
+
+bands=$("$VMSIM" | grep -cE '^[0-9.]+-[0-9.]+ ')
+if [ "$bands" -gt 1 ]; then
+    echo "PASS vmsim-speed-bands"
+else
+    echo "FAIL vmsim-speed-bands: $bands speed bands reported"
+    exit 1
+fi
@@ -0,0 +1,673 @@
+/* 
+ * File:   chain.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A test bench for chains of smart-display modules.
+ * Each module runs the real firmware on the host backend of the HAL,
+ * loaded from its own copy of the shared object. The test bench plays
+ * the part of the hardware: it wires the CCL output of each module to
+ * the RX of the next one, shifts the units out at the speed of the link,
+ * counts the timers and multiplexes the displays in simulated time.
+ */
+
+#include <dlfcn.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "node.hpp"
+
+constexpr uint64_t NS_PER_SEC = 1000000000;
+constexpr uint64_t NS_PER_MS = 1000000;
+constexpr uint32_t RTC_CLOCK_HZ = 32768;
+constexpr uint64_t NEVER = UINT64_MAX;
+constexpr uint8_t MUX_WINDOW = 16; // two refreshes, or one when dimmed
+
+struct options {
+    unsigned nodes = 8;
+    bool forward = false;
+    uint32_t bit_rate = 0; // 0 for the speed of the firmware
+    uint32_t gap_ms = 100;
+    uint32_t resolution_us = 5;
+    uint32_t sample_ms = 0;
+    const char* library = "build/smart-display.so";
+    std::vector<std::pair<unsigned, unsigned>> errors;
+};
+
+/**
+ * A message unit on the wire, between its start bit and its stop bit.
+ */
+struct unit {
+    uint64_t start;
+    uint64_t end;
+    uint8_t data;
+    bool started;
+};
+
+struct handler_stats {
+    uint32_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+struct module {
+    const node* fw;
+    void* handle;
+    uint64_t unit_ns;
+
+    std::deque<unit> rx;
+    std::set<unsigned> errors; // indices of the units received with a frame error
+    std::deque<std::pair<uint8_t, uint64_t>> tx_buffer;
+    bool tx_busy;
+    uint64_t tx_end;
+
+    uint64_t tca_count;
+    uint64_t tcb1_count;
+    uint64_t rtc_count;
+    uint64_t pit_count;
+    bool mux_running;
+    uint64_t mux_next;
+    uint8_t mux_window[MUX_WINDOW];
+    uint8_t mux_index;
+
+    unsigned received;
+    unsigned mirrored;
+    unsigned sent;
+    unsigned lost;
+    uint64_t last_received;
+    uint64_t max_tx_wait;
+    handler_stats handlers[HAL_VECTORS];
+    handler_stats loop;
+};
+
+static std::vector<module> modules;
+static std::vector<unit> chain_output;
+static uint64_t now;
+
+/* --------------------------------------------------------------------- */
+/* the hardware of a module */
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+static void account(handler_stats& stats, uint64_t ns) {
+    ++stats.count;
+    stats.total_ns += ns;
+    if (ns > stats.max_ns) stats.max_ns = ns;
+}
+
+/**
+ * Takes the units written to TXDATAL into the TX buffer of the module.
+ */
+static void collect_tx(module& m) {
+    uint8_t data;
+    while (m.fw->transmitted(data)) m.tx_buffer.emplace_back(data, now);
+}
+
+/**
+ * Registers that the firmware polls, updated before it runs.
+ */
+static void update_status(module& m) {
+    if (m.tx_buffer.empty()) {
+        m.fw->usart->STATUS |= USART_DREIF_bm;
+    } else {
+        m.fw->usart->STATUS &= ~USART_DREIF_bm;
+    }
+    m.fw->tcb0->STATUS = m.fw->tcb0->CTRLA & TCB_ENABLE_bm;
+}
+
+static void raise(module& m, uint8_t vector) {
+    update_status(m);
+    const auto start = std::chrono::steady_clock::now();
+    if (m.fw->raise(vector)) account(m.handlers[vector], elapsed_ns(start));
+    collect_tx(m);
+}
+
+static void run_loop(module& m) {
+    update_status(m);
+    const auto start = std::chrono::steady_clock::now();
+    m.fw->step();
+    account(m.loop, elapsed_ns(start));
+    collect_tx(m);
+}
+
+/**
+ * The CCL output drives the RX of the next module.
+ */
+static bool ccl_mirrors_rx(const module& m) {
+    return (m.fw->ccl->CTRLA & CCL_ENABLE_bm)
+        && (m.fw->ccl->LUT0CTRLC & 0x0F) == CCL_INSEL2_IO_gc;
+}
+
+static bool ccl_mirrors_tx(const module& m) {
+    return (m.fw->ccl->CTRLA & CCL_ENABLE_bm)
+        && (m.fw->ccl->LUT0CTRLB & 0x0F) == CCL_INSEL0_USART0_gc;
+}
+
+static void send_next(size_t index, const unit& u) {
+    unit copy = u;
+    copy.started = false;
+    if (index + 1 < modules.size()) {
+        modules[index + 1].rx.push_back(copy);
+    } else {
+        chain_output.push_back(copy);
+    }
+}
+
+static void run_rx(size_t index) {
+    module& m = modules[index];
+    // a unit starts when the previous one ends, after its RXC IRQ
+    while (!m.rx.empty() && m.rx.front().start <= now) {
+        unit& u = m.rx.front();
+        if (!u.started) {
+            u.started = true;
+            // the unit passes through while the CCL is enabled at its start bit
+            if (ccl_mirrors_rx(m)) {
+                send_next(index, u);
+                ++m.mirrored;
+            }
+        }
+        if (u.end > now) break;
+        const uint8_t data = u.data;
+        m.rx.pop_front();
+        if (!(m.fw->usart->CTRLA & USART_RXCIE_bm)) {
+            ++m.lost;
+            continue;
+        }
+        const bool error = m.errors.count(m.received);
+        ++m.received;
+        m.last_received = now;
+        m.fw->usart->RXDATAH = error ? USART_FERR_bm : 0;
+        m.fw->usart->RXDATAL = data;
+        raise(m, USART0_RXC_vect_num);
+    }
+}
+
+static void run_tx(size_t index) {
+    module& m = modules[index];
+    if (m.tx_busy && m.tx_end <= now) {
+        m.tx_busy = false;
+        ++m.sent;
+        if (m.tx_buffer.empty() && (m.fw->usart->CTRLA & USART_TXCIE_bm)) {
+            m.fw->usart->STATUS |= USART_TXCIF_bm;
+            raise(m, USART0_TXC_vect_num);
+        }
+    }
+    if (!m.tx_busy && !m.tx_buffer.empty()) {
+        const auto written = m.tx_buffer.front();
+        m.tx_buffer.pop_front();
+        if (now - written.second > m.max_tx_wait) m.max_tx_wait = now - written.second;
+        m.tx_busy = true;
+        m.tx_end = now + m.unit_ns;
+        if (ccl_mirrors_tx(m)) send_next(index, {now, m.tx_end, written.first, false});
+    }
+    // the TX data register is free while the previous unit is shifted out
+    if ((m.fw->usart->CTRLA & USART_DREIE_bm) && m.tx_buffer.empty()) {
+        raise(m, USART0_DRE_vect_num);
+    }
+}
+
+/**
+ * Counts at rate_hz for step_ns.
+ * @param fraction The remainder of the last call, in ns * Hz.
+ * @return The number of counts.
+ */
+static uint32_t count(uint64_t& fraction, uint64_t rate_hz, uint64_t step_ns) {
+    fraction += rate_hz * step_ns;
+    const uint32_t counts = fraction / NS_PER_SEC;
+    fraction %= NS_PER_SEC;
+    return counts;
+}
+
+static void run_timers(module& m, uint64_t step_ns) {
+    // TCA0 times out the messages
+    TCA_SINGLE_t& tca = m.fw->tca->SINGLE;
+    if (tca.CTRLA & TCA_SINGLE_ENABLE_bm) {
+        const uint32_t counts = count(m.tca_count, F_CPU / 16, step_ns);
+        if ((uint32_t)tca.CNT + counts > tca.PER) {
+            tca.CNT = 0;
+            tca.INTFLAGS = TCA_SINGLE_OVF_bm;
+            if (tca.INTCTRL & TCA_SINGLE_OVF_bm) raise(m, TCA0_OVF_vect_num);
+        } else {
+            tca.CNT = tca.CNT + counts;
+        }
+    } else {
+        m.tca_count = 0;
+    }
+
+    // TCB1 runs free at CLK_PER
+    m.fw->tcb1->CNT = m.fw->tcb1->CNT + count(m.tcb1_count, F_CPU, step_ns);
+
+    // the RTC counts the ticks and the PIT the seconds
+    RTC_t& rtc = *m.fw->rtc;
+    if (rtc.CTRLA & RTC_RTCEN_bm) {
+        const uint8_t prescaler = (rtc.CTRLA >> 3) & 0x0F;
+        const uint32_t start = rtc.CNT;
+        uint32_t cnt = start + count(m.rtc_count, RTC_CLOCK_HZ >> prescaler, step_ns);
+        uint8_t flags = 0;
+        if (rtc.CMP > start && rtc.CMP <= cnt) flags |= RTC_CMP_bm;
+        if (cnt > rtc.PER) {
+            cnt -= rtc.PER + 1;
+            flags |= RTC_OVF_bm;
+            if (rtc.CMP <= cnt) flags |= RTC_CMP_bm;
+        }
+        rtc.CNT = cnt;
+        rtc.INTFLAGS.set(flags);
+        if (rtc.INTCTRL & rtc.INTFLAGS) raise(m, RTC_CNT_vect_num);
+    }
+    if (rtc.PITCTRLA & RTC_PITEN_bm) {
+        const uint32_t period = 4u << (((rtc.PITCTRLA >> 3) & 0x0F) - 1);
+        m.pit_count += RTC_CLOCK_HZ * step_ns;
+        if (m.pit_count >= (uint64_t)period * NS_PER_SEC) {
+            m.pit_count -= (uint64_t)period * NS_PER_SEC;
+            if (rtc.PITINTCTRL & RTC_PI_bm) raise(m, RTC_PIT_vect_num);
+        }
+    }
+
+    // TCB0 multiplexes the segments at CLK_PER/2
+    TCB_t& tcb0 = *m.fw->tcb0;
+    if (!(tcb0.CTRLA & TCB_ENABLE_bm)) {
+        m.mux_running = false;
+        memset(m.mux_window, 0, sizeof(m.mux_window));
+        return;
+    }
+    if (!m.mux_running) {
+        m.mux_running = true;
+        m.mux_next = now + (tcb0.CCMP + 1) * 2 * NS_PER_SEC / F_CPU;
+    }
+    while (m.mux_next <= now) {
+        raise(m, TCB0_INT_vect_num);
+        uint8_t segments = 0;
+        // the pins of segments a..g and dp, in the order of the map
+        const uint8_t portb = m.fw->portb->OUT;
+        const uint8_t porta = m.fw->porta->OUT;
+        if (portb & (1 << 5)) segments |= 0x01;
+        if (portb & (1 << 4)) segments |= 0x02;
+        if (portb & (1 << 2)) segments |= 0x04;
+        if (portb & (1 << 1)) segments |= 0x08;
+        if (portb & (1 << 0)) segments |= 0x10;
+        if (porta & (1 << 7)) segments |= 0x20;
+        if (porta & (1 << 6)) segments |= 0x40;
+        if (portb & (1 << 3)) segments |= 0x80;
+        m.mux_window[m.mux_index] = segments;
+        m.mux_index = (m.mux_index + 1) % MUX_WINDOW;
+        m.mux_next += (tcb0.CCMP + 1) * 2 * NS_PER_SEC / F_CPU;
+    }
+}
+
+/**
+ * The segments lit during the last refresh of the display.
+ */
+static uint8_t displayed(const module& m) {
+    uint8_t segments = 0;
+    for (uint8_t lit : m.mux_window) segments |= lit;
+    return segments;
+}
+
+static void print_glyph(const module& m, uint8_t segments) {
+    if (!segments) {
+        putchar(' ');
+        return;
+    }
+    // letters first, since some of them look like digits
+    static const char codes[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+        "-_=\"'()[]{}<>/\\|!?.,:;+*#$%&@^`~";
+    for (const char* p = codes; *p; ++p) {
+        const char code = *p;
+        if (m.fw->char_to_segs(code) == segments) {
+            putchar(code);
+            return;
+        }
+        if (m.fw->char_to_segs(code | 0x80) == segments) {
+            putchar(code);
+            putchar('.');
+            return;
+        }
+    }
+    printf("[%02x]", segments);
+}
+
+static void print_display() {
+    printf("%10.3f ms |", (double)now / NS_PER_MS);
+    for (const module& m : modules) print_glyph(m, displayed(m));
+    printf("|\n");
+}
+
+/* --------------------------------------------------------------------- */
+/* the chain */
+
+static bool idle() {
+    for (const module& m : modules) {
+        if (!m.rx.empty() || m.tx_busy || !m.tx_buffer.empty()) return false;
+        if (m.fw->tca->SINGLE.CTRLA & TCA_SINGLE_ENABLE_bm) return false;
+    }
+    return true;
+}
+
+static void run_step(const options& opts) {
+    const uint64_t step_ns = opts.resolution_us * 1000ull;
+    now += step_ns;
+    // in order along the chain, so that mirrored units pass through at once
+    for (size_t index = 0; index < modules.size(); ++index) {
+        run_rx(index);
+        run_tx(index);
+        run_timers(modules[index], step_ns);
+        run_loop(modules[index]);
+    }
+    if (opts.sample_ms && now % (opts.sample_ms * NS_PER_MS) < step_ns) print_display();
+}
+
+static uint64_t host_unit_ns(const options& opts) {
+    // the host uses the framing of the first module
+    const uint8_t bits = (modules[0].fw->usart->CTRLC & 0x30) ? 11 : 10;
+    return bits * NS_PER_SEC / opts.bit_rate;
+}
+
+static void send_message(const std::vector<uint8_t>& message, unsigned number, const options& opts) {
+    const uint64_t unit_ns = host_unit_ns(opts);
+    const uint64_t start = now;
+    uint64_t time = now;
+    for (uint8_t data : message) {
+        modules[0].rx.push_back({time, time + unit_ns, data, false});
+        time += unit_ns;
+    }
+    chain_output.clear();
+    for (module& m : modules) m.last_received = NEVER;
+
+    while (!idle()) run_step(opts);
+    const uint64_t end = now;
+    const uint64_t settled = now + opts.gap_ms * NS_PER_MS;
+    while (now < settled) run_step(opts);
+
+    printf("message %u: %zu units at %.3f ms, chain idle after %.3f ms\n",
+           number, message.size(), (double)start / NS_PER_MS, (double)(end - start) / NS_PER_MS);
+    printf("  last unit received (ms):");
+    for (const module& m : modules) {
+        if (m.last_received != NEVER) {
+            printf(" %.3f", (double)(m.last_received - start) / NS_PER_MS);
+        } else {
+            printf(" -");
+        }
+    }
+    printf("\n  chain output:");
+    for (const unit& u : chain_output) printf(" %02X", u.data);
+    printf("\n  display:");
+    print_display();
+}
+
+static void print_handler(const handler_stats& stats) {
+    if (!stats.count) {
+        printf(" %8s %8s", "-", "-");
+        return;
+    }
+    printf(" %8u %8" PRIu64, stats.count, stats.total_ns / stats.count);
+}
+
+static void print_statistics() {
+    static const struct {
+        const char* name;
+        uint8_t vector;
+    } vectors[] = {
+        {"RXC", USART0_RXC_vect_num},
+        {"DRE", USART0_DRE_vect_num},
+        {"TCA", TCA0_OVF_vect_num},
+        {"MUX", TCB0_INT_vect_num},
+        {"RTC", RTC_CNT_vect_num},
+    };
+
+    printf("\nmodule      rx  mirror      tx  lost errors dropped tx_wait_us");
+    for (const auto& vector : vectors) printf(" %8s %8s", vector.name, "avg_ns");
+    printf(" %8s %8s %8s\n", "loop", "avg_ns", "max_ns");
+    for (size_t index = 0; index < modules.size(); ++index) {
+        const module& m = modules[index];
+        uint16_t rx_errors, dropped;
+        m.fw->counters(rx_errors, dropped);
+        printf("%6zu %7u %7u %7u %5u %6u %7u %10.1f",
+               index, m.received, m.mirrored, m.sent, m.lost, rx_errors, dropped,
+               (double)m.max_tx_wait / 1000);
+        for (const auto& vector : vectors) print_handler(m.handlers[vector.vector]);
+        print_handler(m.loop);
+        printf(" %8" PRIu64 "\n", m.loop.max_ns);
+    }
+    printf("\nISR and loop times are host times, a proxy for the cycles on the device.\n");
+}
+
+/* --------------------------------------------------------------------- */
+/* setup */
+
+/**
+ * Loads a copy of the firmware: the dynamic loader shares the objects
+ * loaded from the same path.
+ */
+static bool load(module& m, const char* library, const char* directory, unsigned index) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/node%u.so", directory, index);
+    FILE* in = fopen(library, "rb");
+    FILE* out = fopen(path, "wb");
+    bool copied = in && out;
+    char buffer[65536];
+    size_t size;
+    while (copied && (size = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        copied = fwrite(buffer, 1, size, out) == size;
+    }
+    if (in) fclose(in);
+    if (out) fclose(out);
+    if (!copied) {
+        fprintf(stderr, "chain: error: cannot copy %s to %s\n", library, path);
+        return false;
+    }
+
+    m.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    unlink(path);
+    if (!m.handle) {
+        fprintf(stderr, "chain: error: %s\n", dlerror());
+        return false;
+    }
+    const auto entry = (hal_node_function)dlsym(m.handle, "hal_node");
+    if (!entry) {
+        fprintf(stderr, "chain: error: %s\n", dlerror());
+        return false;
+    }
+    m.fw = entry();
+    return true;
+}
+
+static bool setup(options& opts) {
+    char directory[] = "/tmp/chain.XXXXXX";
+    if (!mkdtemp(directory)) {
+        perror("chain: error: mkdtemp");
+        return false;
+    }
+    modules.resize(opts.nodes);
+    bool loaded = true;
+    for (unsigned index = 0; loaded && index < opts.nodes; ++index) {
+        loaded = load(modules[index], opts.library, directory, index);
+    }
+    rmdir(directory);
+    if (!loaded) return false;
+
+    for (module& m : modules) {
+        // fuse1 selects the store-and-forward mode (soldered fuses read as 1)
+        m.fw->portc->IN = opts.forward ? 0x02 : 0x00;
+        m.fw->init();
+        if (opts.bit_rate) {
+            m.fw->usart->BAUD = (uint16_t)((4ull * F_CPU + opts.bit_rate / 2) / opts.bit_rate);
+        }
+        const uint8_t bits = (m.fw->usart->CTRLC & 0x30) ? 11 : 10;
+        // bit time = BAUD / (4 * F_CPU)
+        m.unit_ns = bits * m.fw->usart->BAUD * (NS_PER_SEC / 4) / F_CPU;
+    }
+    if (!opts.bit_rate) {
+        opts.bit_rate = (uint32_t)((4ull * F_CPU + modules[0].fw->usart->BAUD / 2) / modules[0].fw->usart->BAUD);
+    }
+    for (const auto& error : opts.errors) {
+        if (error.first < modules.size()) modules[error.first].errors.insert(error.second);
+    }
+    return true;
+}
+
+static bool parse_message(const char* line, std::vector<uint8_t>& message) {
+    message.clear();
+    const char* p = line;
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == ',') ++p;
+        if (!*p || *p == '\n' || *p == '#') return true;
+        char* end;
+        const unsigned long value = strtoul(p, &end, 16);
+        if (end == p || value > 0xFF) return false;
+        message.push_back((uint8_t)value);
+        p = end;
+    }
+}
+
+static void print_usage(const char* tool_name, bool help_mode) {
+    fprintf(stderr,
+            "Usage: %s\t[-fh] [-b BIT_RATE] [-e MODULE:UNIT] [-g GAP_MS] [-l LIBRARY]\n"
+            "\t\t[-n MODULES] [-r RESOLUTION_US] [-t SAMPLE_MS]\n",
+            tool_name);
+    if (help_mode) {
+        fprintf(stderr,
+                "\n"
+                "Runs a chain of smart-display modules on the host and sends it the\n"
+                "messages read from the standard input, one per line, as hexadecimal\n"
+                "units (example: 41 42 43). Prints the units received by each module,\n"
+                "the display after each message and the statistics of each module.\n"
+                "\n"
+                "optional arguments:\n"
+                "-h, --help\tshow this help message and exit\n"
+                "-f, --forward\tsolder fuse 1 of the modules (store-and-forward mode)\n"
+                "-b BIT_RATE, --speed BIT_RATE\n"
+                "\t\tthe transmission speed in bps (default: the speed of the firmware)\n"
+                "-e MODULE:UNIT, --error MODULE:UNIT\n"
+                "\t\treceive the UNIT-th unit of MODULE with a frame error (repeatable)\n"
+                "-g GAP_MS, --gap GAP_MS\n"
+                "\t\tthe time between two messages, after the chain is idle (default: 100)\n"
+                "-l LIBRARY, --library LIBRARY\n"
+                "\t\tthe firmware (default: build/smart-display.so)\n"
+                "-n MODULES, --modules MODULES\n"
+                "\t\tthe number of modules (default: 8)\n"
+                "-r RESOLUTION_US, --resolution RESOLUTION_US\n"
+                "\t\tthe step of the simulated time (default: 5)\n"
+                "-t SAMPLE_MS, --sample SAMPLE_MS\n"
+                "\t\tprint the display every SAMPLE_MS of simulated time\n"
+                );
+    }
+}
+
+int main(int argc, char* argv[]) {
+    static const struct option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"forward", no_argument, nullptr, 'f'},
+        {"speed", required_argument, nullptr, 'b'},
+        {"error", required_argument, nullptr, 'e'},
+        {"gap", required_argument, nullptr, 'g'},
+        {"library", required_argument, nullptr, 'l'},
+        {"modules", required_argument, nullptr, 'n'},
+        {"resolution", required_argument, nullptr, 'r'},
+        {"sample", required_argument, nullptr, 't'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    options opts;
+    int option;
+    while ((option = getopt_long(argc, argv, "hfb:e:g:l:n:r:t:", long_options, nullptr)) != -1) {
+        switch (option) {
+            case 'h':
+                print_usage(argv[0], true);
+                return EXIT_SUCCESS;
+            case 'f':
+                opts.forward = true;
+                break;
+            case 'b':
+                opts.bit_rate = strtoul(optarg, nullptr, 10);
+                break;
+            case 'e': {
+                unsigned module_index, unit_index;
+                if (sscanf(optarg, "%u:%u", &module_index, &unit_index) != 2) {
+                    fprintf(stderr, "%s: error: '%s' is an invalid error: please specify MODULE:UNIT\n",
+                            argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                opts.errors.emplace_back(module_index, unit_index);
+                break;
+            }
+            case 'g':
+                opts.gap_ms = strtoul(optarg, nullptr, 10);
+                break;
+            case 'l':
+                opts.library = optarg;
+                break;
+            case 'n':
+                opts.nodes = strtoul(optarg, nullptr, 10);
+                break;
+            case 'r':
+                opts.resolution_us = strtoul(optarg, nullptr, 10);
+                break;
+            case 't':
+                opts.sample_ms = strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                print_usage(argv[0], false);
+                return EXIT_FAILURE;
+        }
+    }
+    if (!opts.nodes || !opts.resolution_us || optind != argc) {
+        print_usage(argv[0], false);
+        return EXIT_FAILURE;
+    }
+
+    if (!setup(opts)) return EXIT_FAILURE;
+    printf("%u modules in %s mode at %u bps\n",
+           opts.nodes, opts.forward ? "store-and-forward" : "mirror", opts.bit_rate);
+
+    char line[4096];
+    unsigned number = 0;
+    while (fgets(line, sizeof(line), stdin)) {
+        std::vector<uint8_t> message;
+        if (!parse_message(line, message)) {
+            fprintf(stderr, "%s: error: invalid message: %s", argv[0], line);
+            return EXIT_FAILURE;
+        }
+        if (message.empty()) continue;
+        send_message(message, ++number, opts);
+    }
+    print_statistics();
+    return EXIT_SUCCESS;
+}
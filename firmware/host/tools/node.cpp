@@ -1,5 +1,5 @@
-/*
- * File:   cpu.cpp
+/* 
+ * File:   node.cpp
  * Author: Gabriele Falcioni <foss.dev@falcioni.net>
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,30 +24,41 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <stdint.h>
-
 #include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/sleep.h>
 
-extern "C" {
-// the function ccp_write_io() was not declared with C linkage
-#include <avr/cpufunc.h>
-}
+#include <stdint.h>
 
-#include "cpu.hpp"
+#include "display.hpp"
+#include "hal.hpp"
+#include "node.hpp"
+#include "serial.hpp"
+#include "smart_display.hpp"
 
-namespace cpu {
+static void counters(uint16_t& rx_errors, uint16_t& dropped) {
+    const serial::counters result = serial::get_counters();
+    rx_errors = result.rx_errors;
+    dropped = result.dropped;
+}
 
-    void idle() {
-        cli();
-        sleep_enable();
-        sei();
-        sleep_cpu();
-        sleep_disable();
-    }
+static const node instance = {
+    smart_display::init,
+    smart_display::step,
+    hal::raise,
+    hal::transmitted,
+    display::char_to_segs,
+    counters,
+    &PORTA,
+    &PORTB,
+    &PORTC,
+    &USART0,
+    &TCA0,
+    &TCB0,
+    &TCB1,
+    &RTC,
+    &CCL,
+    &CPU
+};
 
-    void irq_roundrobin() {
-        ccp_write_io((uint8_t*)&CPUINT_CTRLA, CPUINT_LVL0RR_bm);
-    }
+const node* hal_node() {
+    return &instance;
 }
@@ -1,5 +1,5 @@
 /* 
- * File:   key.hpp
+ * File:   node.hpp
  * Author: Gabriele Falcioni <foss.dev@falcioni.net>
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,37 +24,44 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifndef KEY_HPP_INCLUDED
-#define	KEY_HPP_INCLUDED
+#ifndef NODE_HPP_INCLUDED
+#define NODE_HPP_INCLUDED
 
-namespace key {
+#include <avr/io.h>
 
-    enum class state_t: bool {
-        released = false,
-        pressed = true,
-    };
+#include <stdint.h>
 
-    /**
-     * Initialises the hardware resources related to the key.
-     * GPIO: PC3.
-     */
-    void init();
-
-    /**
-     * @return true if the key has changed state since last check, false otherwise.
-     */
-    bool changed();
+/**
+ * A module of the chain: the smart-display firmware built as a shared
+ * object with its own copy of the HAL backend, so each module has its
+ * own registers and state.
+ * The functions are reached through this table, to keep the test bench
+ * free of mangled names.
+ */
+struct node {
+    void (*init)();
+    void (*step)();
+    bool (*raise)(uint8_t vector);
+    bool (*transmitted)(uint8_t& data);
+    uint8_t (*char_to_segs)(char code);
+    void (*counters)(uint16_t& rx_errors, uint16_t& dropped);
+    PORT_t* porta;
+    PORT_t* portb;
+    PORT_t* portc;
+    USART_t* usart;
+    TCA_t* tca;
+    TCB_t* tcb0;
+    TCB_t* tcb1;
+    RTC_t* rtc;
+    CCL_t* ccl;
+    CPU_t* cpu;
+};
 
-    /**
-     * @return Current key state.
-     */
-    state_t state();
+/**
+ * The entry point of the shared object.
+ */
+extern "C" const node* hal_node();
 
-    /**
-     * Runs the key management algorithm.
-     * Call this function at each tick.
-     */
-    void run();
-}
+using hal_node_function = const node* (*)();
 
-#endif	/* KEY_HPP_INCLUDED */
+#endif /* NODE_HPP_INCLUDED */
@@ -0,0 +1,249 @@
+/* 
+ * File:   replay.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Replays a game recorded by the racing game (@see recorder.hpp) on the VM
+ * of the firmware (game_vm.cpp) and prints each segment shown, with the
+ * nominal time of the move and the slack of each key press.
+ * The VM is deterministic, so the segments are the ones the player saw.
+ * The tool provides the display and link functions called by the VM,
+ * so their drivers are not linked.
+ */
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "display.hpp"
+#include "game_vm.hpp"
+#include "link.hpp"
+#include "protocol.hpp"
+#include "recorder.hpp"
+#include "timer.hpp"
+
+/**
+ * The time unit of the replay: the RTC counts with the fraction
+ * bits of the VM wait time, as in the game loop.
+ */
+constexpr double UNITS_PER_MS = ((uint32_t)timer::COUNTS_PER_SEC << vm::WAIT_FRACTION_BITS) / 1000.0;
+constexpr double COUNTS_PER_MS = timer::COUNTS_PER_SEC / 1000.0;
+
+struct game_record {
+    recorder::header head;
+    std::vector<recorder::entry> steers;
+};
+
+static bool quiet;
+static unsigned tick;
+static uint64_t time_units; // the nominal time of the current move
+
+static void print_segments(uint8_t module, uint8_t map) {
+    if (quiet) return;
+    char names[9] = {};
+    char* p = names;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        if (map & (1 << bit)) *p++ = "abcdefg."[bit];
+    }
+    printf("%7u %10.1f %7u  %-8s\n", tick, time_units / UNITS_PER_MS, module, map ? names : "-");
+}
+
+namespace display {
+
+    void show_segments(uint8_t map) {
+        print_segments(0, map);
+    }
+
+    void show_char(char code) {
+        // the VM only shows characters on invalid instructions
+        printf("%7u %10.1f       0  '%c' (invalid instruction)\n", tick, time_units / UNITS_PER_MS, code & 0x7F);
+        exit(EXIT_FAILURE);
+    }
+}
+
+namespace link {
+
+    void show_segments(uint8_t module, uint8_t segments) {
+        print_segments(module + 1, segments);
+    }
+}
+
+static uint16_t get_word(const std::vector<uint8_t>& data, size_t offset) {
+    return data[offset] | data[offset + 1] << 8;
+}
+
+/**
+ * Parses a dump: the header, the steers and the CRC-8 of both.
+ */
+static bool parse(const char* tool_name, const std::vector<uint8_t>& data, game_record& record) {
+    constexpr size_t HEADER_SIZE = 8;
+    constexpr size_t ENTRY_SIZE = 4;
+    if (data.size() < HEADER_SIZE + 1) {
+        fprintf(stderr, "%s: error: the dump is too short (%zu bytes)\n", tool_name, data.size());
+        return false;
+    }
+    recorder::header& head = record.head;
+    head.version = data[0];
+    head.start_speed = data[1];
+    head.track = get_word(data, 2);
+    head.score = get_word(data, 4);
+    head.steers = data[6];
+    head.flags = data[7];
+    if (head.version != recorder::FORMAT_VERSION) {
+        fprintf(stderr, "%s: error: no game recorded (format %u, expected %u)\n",
+                tool_name, head.version, recorder::FORMAT_VERSION);
+        return false;
+    }
+    const size_t size = HEADER_SIZE + head.steers * ENTRY_SIZE;
+    if (head.steers > recorder::MAX_STEERS || data.size() < size + 1) {
+        fprintf(stderr, "%s: error: the dump is truncated (%zu bytes, expected %zu)\n",
+                tool_name, data.size(), size + 1);
+        return false;
+    }
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) crc = protocol::crc8(crc, data[i]);
+    if (crc != data[size]) {
+        fprintf(stderr, "%s: error: CRC mismatch (%02X, expected %02X)\n", tool_name, data[size], crc);
+        return false;
+    }
+    for (size_t offset = HEADER_SIZE; offset < size; offset += ENTRY_SIZE) {
+        record.steers.push_back({ get_word(data, offset), (int16_t)get_word(data, offset + 2) });
+    }
+    return true;
+}
+
+static void vm_tick() {
+    vm::tick_event();
+    time_units += vm::wait_time();
+    ++tick;
+}
+
+/**
+ * Replays the record: the ticks before each steer, then the steer.
+ * @return The number of crashes.
+ */
+static unsigned replay(const game_record& record) {
+    unsigned crashes = 0;
+    vm::reset(record.head.start_speed);
+    if (!quiet) printf("   tick    time_ms  module  segments  event\n");
+    for (const recorder::entry& steer : record.steers) {
+        for (uint16_t i = 0; i < steer.ticks; ++i) vm_tick();
+        if (!quiet) {
+            printf("%7u %10.1f                   steer %+.1f ms %s\n",
+                   tick, time_units / UNITS_PER_MS, steer.slack / COUNTS_PER_MS,
+                   steer.slack > 0 ? "before the move" : "late, after a move");
+        }
+        if (!vm::steer_event()) {
+            ++crashes;
+            if (!quiet) printf("%7u %10.1f                   crash, %u cars left\n",
+                               tick, time_units / UNITS_PER_MS, vm::remaining_cars());
+        }
+    }
+    return crashes;
+}
+
+static void print_usage(const char* tool_name, bool help_mode) {
+    fprintf(stderr, "Usage: %s\t[-h] [-q] [-f] [FILE]\n", tool_name);
+    if (help_mode) {
+        fprintf(stderr,
+                "\n"
+                "Replays a game dumped by the racing game (hold the key at power-on)\n"
+                "and prints the segments shown at each VM tick, with the nominal time\n"
+                "of the move in ms, and the key presses. Reads the standard input\n"
+                "without FILE.\n"
+                "\n"
+                "optional arguments:\n"
+                "-h, --help\tshow this help message and exit\n"
+                "-q, --quiet\tonly print the summary\n"
+                "-f, --force\treplay a game recorded on another track\n"
+                );
+    }
+}
+
+int main(int argc, char* argv[]) {
+    static const struct option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"quiet", no_argument, nullptr, 'q'},
+        {"force", no_argument, nullptr, 'f'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    bool force = false;
+    int option;
+    while ((option = getopt_long(argc, argv, "hqf", long_options, nullptr)) != -1) {
+        switch (option) {
+            case 'h':
+                print_usage(argv[0], true);
+                return EXIT_SUCCESS;
+            case 'q':
+                quiet = true;
+                break;
+            case 'f':
+                force = true;
+                break;
+            default:
+                print_usage(argv[0], false);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind > 1) {
+        print_usage(argv[0], false);
+        return EXIT_FAILURE;
+    }
+
+    FILE* input = optind < argc ? fopen(argv[optind], "rb") : stdin;
+    if (!input) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+    std::vector<uint8_t> data;
+    int c;
+    while ((c = fgetc(input)) != EOF) data.push_back(c);
+    if (input != stdin) fclose(input);
+
+    game_record record;
+    if (!parse(argv[0], data, record)) return EXIT_FAILURE;
+    if (record.head.track != vm::track_id() && !force) {
+        fprintf(stderr, "%s: error: the game was recorded on another track (%04X, this build %04X)\n",
+                argv[0], record.head.track, vm::track_id());
+        return EXIT_FAILURE;
+    }
+
+    const unsigned crashes = replay(record);
+    const bool truncated = record.head.flags & recorder::flags::truncated;
+    if (!quiet) printf("\n");
+    printf("%zu steers, %u crashes, %u ticks, score %u",
+           record.steers.size(), crashes, tick, vm::score());
+    if (truncated) {
+        printf(" (truncated record, the game scored %u)\n", record.head.score);
+        return EXIT_SUCCESS;
+    }
+    const bool matches = vm::score() == record.head.score && vm::game_over();
+    printf(" (%s)\n", matches ? "matches the game" : "MISMATCH");
+    return matches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
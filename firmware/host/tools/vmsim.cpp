@@ -0,0 +1,454 @@
+/* 
+ * File:   vmsim.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A headless simulator of the racing game, for balancing the track and
+ * the difficulty curve. It runs the VM of the firmware (game_vm.cpp)
+ * against a model of the player's reaction time, with the timing of the
+ * game loop, and reports the scores and the crashes per speed band.
+ * The games are split among worker processes, one per core by default:
+ * the VM state is a static of the firmware, so each worker owns a copy.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "game_vm.hpp"
+#include "timer.hpp"
+
+/**
+ * The time unit of the simulation: the RTC counts with the fraction
+ * bits of the VM wait time, as in the game loop.
+ */
+constexpr uint64_t UNITS_PER_SEC = (uint64_t)timer::COUNTS_PER_SEC << vm::WAIT_FRACTION_BITS;
+
+/**
+ * The speed bands are BAND_MOVES_PER_SEC wide, from the lowest to the
+ * highest number of moves per second of the VM: the speed restarts from
+ * the lowest after each crash, so the bands must be narrow to show how
+ * the crash rate grows with the speed.
+ */
+constexpr unsigned BAND_MOVES_PER_SEC = 1;
+constexpr unsigned MAX_BANDS = 64;
+
+enum class model: uint8_t {
+    normal,
+    lognormal,
+    uniform,
+};
+
+struct options {
+    uint64_t games = 1000000;
+    unsigned jobs = 0; // 0 for one per core
+    model reaction = model::lognormal;
+    double mean_ms = 250;
+    double spread_ms = 50;
+    double steer = 1.0; // probability to take a safe turn
+    unsigned max_score = 1000;
+    uint64_t seed = 1;
+};
+
+struct band_stats {
+    uint64_t steers;
+    uint64_t crashes;
+};
+
+/**
+ * The results of a worker, sent as is to the parent through a pipe.
+ * The score histogram follows, max_score + 1 counters.
+ */
+struct results {
+    uint64_t games;
+    uint64_t unfinished; // games stopped at max_score
+    uint64_t ticks;
+    band_stats bands[MAX_BANDS];
+};
+
+/**
+ * The player: takes the safe turns, after a random reaction time.
+ */
+class player {
+public:
+    player(const options& opts, uint64_t seed) :
+        opts(opts),
+        random(seed),
+        normal(opts.mean_ms, opts.spread_ms),
+        lognormal(lognormal_mu(opts), lognormal_sigma(opts)),
+        uniform(opts.mean_ms - opts.spread_ms, opts.mean_ms + opts.spread_ms),
+        chance(0, 1) {
+    }
+
+    bool steers() {
+        return opts.steer >= 1 || chance(random) < opts.steer;
+    }
+
+    /**
+     * @return The reaction time in simulation units.
+     */
+    uint64_t reaction() {
+        double ms;
+        switch (opts.reaction) {
+            case model::normal: ms = normal(random); break;
+            case model::lognormal: ms = lognormal(random); break;
+            default: ms = uniform(random); break;
+        }
+        return ms > 0 ? (uint64_t)(ms * UNITS_PER_SEC / 1000) : 0;
+    }
+
+private:
+    static double lognormal_sigma(const options& opts) {
+        const double ratio = opts.spread_ms / opts.mean_ms;
+        return sqrt(log(1 + ratio * ratio));
+    }
+
+    static double lognormal_mu(const options& opts) {
+        const double sigma = lognormal_sigma(opts);
+        return log(opts.mean_ms) - sigma * sigma / 2;
+    }
+
+    const options& opts;
+    std::mt19937_64 random;
+    std::normal_distribution<double> normal;
+    std::lognormal_distribution<double> lognormal;
+    std::uniform_real_distribution<double> uniform;
+    std::uniform_real_distribution<double> chance;
+};
+
+/**
+ * The speed range of the VM, measured before the workers start.
+ */
+static double min_moves_per_sec;
+static double max_moves_per_sec;
+static unsigned bands;
+
+static double moves_per_sec() {
+    return (double)UNITS_PER_SEC / vm::wait_time();
+}
+
+static void measure_speed_range() {
+    vm::reset(0);
+    min_moves_per_sec = moves_per_sec();
+    vm::reset(255);
+    max_moves_per_sec = moves_per_sec();
+    bands = std::min((unsigned)ceil((max_moves_per_sec - min_moves_per_sec) / BAND_MOVES_PER_SEC), MAX_BANDS);
+}
+
+static double band_moves_per_sec(unsigned band) {
+    return std::min(min_moves_per_sec + band * BAND_MOVES_PER_SEC, max_moves_per_sec);
+}
+
+static unsigned speed_band() {
+    const double band = (moves_per_sec() - min_moves_per_sec) / BAND_MOVES_PER_SEC;
+    return band > 0 ? std::min((unsigned)band, bands - 1) : 0;
+}
+
+/**
+ * Plays one life as play_game() does: the VM ticks at its deadlines and
+ * a key press is judged after the ticks that elapsed before it.
+ * @return false if the score reached the limit.
+ */
+static bool play_life(player& p, const options& opts, results& r) {
+    vm::tick_event();
+    ++r.ticks;
+    uint64_t shown = 0; // the time the current instruction was shown
+    uint64_t deadline = vm::wait_time();
+    for (;;) {
+        if (vm::score() >= opts.max_score) return false;
+        if (vm::may_steer_safely() && p.steers()) {
+            const uint64_t press = shown + p.reaction();
+            while (press >= deadline) {
+                vm::tick_event();
+                ++r.ticks;
+                deadline += vm::wait_time();
+            }
+            band_stats& band = r.bands[speed_band()];
+            ++band.steers;
+            if (!vm::steer_event()) {
+                ++band.crashes;
+                return true;
+            }
+            shown = press;
+        } else {
+            vm::tick_event();
+            ++r.ticks;
+            shown = deadline;
+            deadline += vm::wait_time();
+        }
+    }
+}
+
+static void run_games(uint64_t games, uint64_t seed, const options& opts, results& r, std::vector<uint64_t>& scores) {
+    player p(opts, seed);
+    for (uint64_t game = 0; game < games; ++game) {
+        vm::reset();
+        bool finished = true;
+        while (finished && !vm::game_over()) finished = play_life(p, opts, r);
+        if (!finished) ++r.unfinished;
+        ++scores[std::min<unsigned>(vm::score(), opts.max_score)];
+        ++r.games;
+    }
+}
+
+static bool write_all(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size) {
+        const ssize_t written = write(fd, p, size);
+        if (written <= 0) return false;
+        p += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size) {
+        const ssize_t count = read(fd, p, size);
+        if (count <= 0) return false;
+        p += count;
+        size -= count;
+    }
+    return true;
+}
+
+/**
+ * Runs the games in worker processes and merges their results.
+ */
+static bool run_jobs(const options& opts, results& total, std::vector<uint64_t>& scores) {
+    struct job {
+        pid_t pid;
+        int fd;
+    };
+    std::vector<job> jobs;
+    for (unsigned index = 0; index < opts.jobs; ++index) {
+        const uint64_t games = opts.games / opts.jobs + (index < opts.games % opts.jobs);
+        int fds[2];
+        if (pipe(fds)) {
+            perror("vmsim: error: pipe");
+            return false;
+        }
+        const pid_t pid = fork();
+        if (pid < 0) {
+            perror("vmsim: error: fork");
+            return false;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            results r = {};
+            std::vector<uint64_t> s(opts.max_score + 1);
+            run_games(games, opts.seed + index, opts, r, s);
+            const bool sent = write_all(fds[1], &r, sizeof(r))
+                && write_all(fds[1], s.data(), s.size() * sizeof(s[0]));
+            _exit(sent ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        close(fds[1]);
+        jobs.push_back({pid, fds[0]});
+    }
+
+    bool merged = true;
+    std::vector<uint64_t> s(opts.max_score + 1);
+    for (const job& j : jobs) {
+        results r;
+        if (read_all(j.fd, &r, sizeof(r)) && read_all(j.fd, s.data(), s.size() * sizeof(s[0]))) {
+            total.games += r.games;
+            total.unfinished += r.unfinished;
+            total.ticks += r.ticks;
+            for (unsigned band = 0; band < bands; ++band) {
+                total.bands[band].steers += r.bands[band].steers;
+                total.bands[band].crashes += r.bands[band].crashes;
+            }
+            for (size_t score = 0; score < s.size(); ++score) scores[score] += s[score];
+        } else {
+            fprintf(stderr, "vmsim: error: worker %d failed\n", (int)j.pid);
+            merged = false;
+        }
+        close(j.fd);
+        int status;
+        waitpid(j.pid, &status, 0);
+    }
+    return merged;
+}
+
+static unsigned percentile(const std::vector<uint64_t>& scores, uint64_t games, double fraction) {
+    const uint64_t rank = (uint64_t)(fraction * (games - 1));
+    uint64_t count = 0;
+    for (size_t score = 0; score < scores.size(); ++score) {
+        count += scores[score];
+        if (count > rank) return score;
+    }
+    return scores.size() - 1;
+}
+
+static void print_results(const options& opts, const results& r, const std::vector<uint64_t>& scores, double seconds) {
+    double sum = 0;
+    for (size_t score = 0; score < scores.size(); ++score) sum += (double)score * scores[score];
+
+    printf("%" PRIu64 " games in %.2f s (%.0f games/s, %.0f VM ticks/s) on %u workers\n",
+           r.games, seconds, r.games / seconds, r.ticks / seconds, opts.jobs);
+    printf("\nscore    mean     p10     p50     p90     p99     max  unfinished\n");
+    printf("      %7.1f %7u %7u %7u %7u %7u %11" PRIu64 "\n",
+           sum / r.games,
+           percentile(scores, r.games, 0.10), percentile(scores, r.games, 0.50),
+           percentile(scores, r.games, 0.90), percentile(scores, r.games, 0.99),
+           percentile(scores, r.games, 1.0), r.unfinished);
+
+    printf("\nmoves/s        steers     crashes  crash %%\n");
+    for (unsigned band = 0; band < bands; ++band) {
+        const band_stats& b = r.bands[band];
+        if (!b.steers) continue;
+        char name[16];
+        snprintf(name, sizeof(name), "%.1f-%.1f", band_moves_per_sec(band), band_moves_per_sec(band + 1));
+        printf("%-9s %11" PRIu64 " %11" PRIu64 " %8.3f\n",
+               name, b.steers, b.crashes, 100.0 * b.crashes / b.steers);
+    }
+}
+
+static void print_usage(const char* tool_name, bool help_mode) {
+    fprintf(stderr,
+            "Usage: %s\t[-h] [-g GAMES] [-j JOBS] [-m MODEL] [-r MEAN_MS] [-s SPREAD_MS]\n"
+            "\t\t[-p PROBABILITY] [-x MAX_SCORE] [-z SEED]\n",
+            tool_name);
+    if (help_mode) {
+        fprintf(stderr,
+                "\n"
+                "Plays the racing game on the host with a model of the player's reaction\n"
+                "time and prints the distribution of the scores and the crashes per\n"
+                "speed band, one move per second wide.\n"
+                "\n"
+                "optional arguments:\n"
+                "-h, --help\tshow this help message and exit\n"
+                "-g GAMES, --games GAMES\n"
+                "\t\tthe number of games (default: 1000000)\n"
+                "-j JOBS, --jobs JOBS\n"
+                "\t\tthe number of worker processes (default: one per core)\n"
+                "-m MODEL, --model MODEL\n"
+                "\t\tthe reaction time distribution: normal, lognormal or uniform\n"
+                "\t\t(default: lognormal)\n"
+                "-r MEAN_MS, --reaction MEAN_MS\n"
+                "\t\tthe mean reaction time (default: 250)\n"
+                "-s SPREAD_MS, --spread SPREAD_MS\n"
+                "\t\tthe standard deviation, or the half width of the uniform model\n"
+                "\t\t(default: 50)\n"
+                "-p PROBABILITY, --steer PROBABILITY\n"
+                "\t\tthe probability to take a safe turn (default: 1)\n"
+                "-x MAX_SCORE, --max-score MAX_SCORE\n"
+                "\t\tstop the games reaching this score (default: 1000)\n"
+                "-z SEED, --seed SEED\n"
+                "\t\tthe seed of the first worker, the next ones add their index (default: 1)\n"
+                );
+    }
+}
+
+int main(int argc, char* argv[]) {
+    static const struct option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"games", required_argument, nullptr, 'g'},
+        {"jobs", required_argument, nullptr, 'j'},
+        {"model", required_argument, nullptr, 'm'},
+        {"reaction", required_argument, nullptr, 'r'},
+        {"spread", required_argument, nullptr, 's'},
+        {"steer", required_argument, nullptr, 'p'},
+        {"max-score", required_argument, nullptr, 'x'},
+        {"seed", required_argument, nullptr, 'z'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    options opts;
+    int option;
+    while ((option = getopt_long(argc, argv, "hg:j:m:r:s:p:x:z:", long_options, nullptr)) != -1) {
+        switch (option) {
+            case 'h':
+                print_usage(argv[0], true);
+                return EXIT_SUCCESS;
+            case 'g':
+                opts.games = strtoull(optarg, nullptr, 10);
+                break;
+            case 'j':
+                opts.jobs = strtoul(optarg, nullptr, 10);
+                break;
+            case 'm':
+                if (!strcmp(optarg, "normal")) {
+                    opts.reaction = model::normal;
+                } else if (!strcmp(optarg, "lognormal")) {
+                    opts.reaction = model::lognormal;
+                } else if (!strcmp(optarg, "uniform")) {
+                    opts.reaction = model::uniform;
+                } else {
+                    fprintf(stderr, "%s: error: '%s' is an invalid model\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'r':
+                opts.mean_ms = strtod(optarg, nullptr);
+                break;
+            case 's':
+                opts.spread_ms = strtod(optarg, nullptr);
+                break;
+            case 'p':
+                opts.steer = strtod(optarg, nullptr);
+                break;
+            case 'x':
+                opts.max_score = strtoul(optarg, nullptr, 10);
+                break;
+            case 'z':
+                opts.seed = strtoull(optarg, nullptr, 10);
+                break;
+            default:
+                print_usage(argv[0], false);
+                return EXIT_FAILURE;
+        }
+    }
+    if (!opts.games || opts.mean_ms <= 0 || opts.spread_ms < 0 || opts.steer <= 0 || optind != argc) {
+        print_usage(argv[0], false);
+        return EXIT_FAILURE;
+    }
+    if (!opts.jobs) {
+        const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        opts.jobs = cores > 0 ? cores : 1;
+    }
+    if (opts.jobs > opts.games) opts.jobs = opts.games;
+
+    measure_speed_range();
+    results total = {};
+    std::vector<uint64_t> scores(opts.max_score + 1);
+    const auto start = std::chrono::steady_clock::now();
+    if (!run_jobs(opts, total, scores)) return EXIT_FAILURE;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    print_results(opts, total, scores, elapsed.count());
+    return EXIT_SUCCESS;
+}
@@ -1,5 +1,5 @@
 /* 
- * File:   timer.hpp
+ * File:   config.hpp
  * Author: Gabriele Falcioni
  *
  * Copyright 2022 Gabriele Falcioni
@@ -24,65 +24,55 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifndef TIMER_HPP_INCLUDED
-#define	TIMER_HPP_INCLUDED
+#ifndef CONFIG_HPP_INCLUDED
+#define CONFIG_HPP_INCLUDED
 
 #include <stdint.h>
 
-namespace timer {
-    /**
-     * The number of ticks in one second.
-     */
-    constexpr uint8_t TICKS_PER_SEC = 50;
-
-    /**
-     * Initialises the timer state and peripherals.
-     * The timer starts to count ticks and seconds.
-     */
-    void init();
+#include "pins.hpp"
 
-    /**
-     * Clears the timer state.
-     * All counters are resets to zero and the timeout is canceled.
-     */
-    void reset();
+/**
+ * The configuration of the core drivers for the racing game.
+ * Each application provides its own, the core drivers are built with it.
+ */
+namespace config {
 
     /**
-     * Gets the number of elapsed ticks.
-     * This counter is only 8-bit wide so it wraps around often.
-     * @return The number of elapsed ticks.
+     * The pins of the segments, in the order of the segment maps
+     * (a, b, c, d, e, f, g, dp).
      */
-    uint8_t ticks();
+    constexpr pins::pin SEGMENT_PINS[] = {
+        {pins::port::b, 5}, // a
+        {pins::port::b, 4}, // b
+        {pins::port::b, 2}, // c
+        {pins::port::b, 1}, // d
+        {pins::port::b, 0}, // e
+        {pins::port::a, 7}, // f
+        {pins::port::a, 6}, // g
+        {pins::port::b, 3}, // dp
+    };
 
     /**
-     * Gets the number of elapsed seconds.
-     * @return The number of elapsed seconds.
+     * The interval to keep a segment turned on, in milliseconds.
      */
-    uint16_t seconds();
+    constexpr uint16_t MUX_INTERVAL_MS = 1;
 
     /**
-     * Configures and enables a timeout in the future.
-     * @param ticks The number of ticks to wait.
+     * The frequency of the timer ticks.
      */
-    void enable(uint8_t ticks);
+    constexpr uint8_t TICKS_PER_SEC = 50;
 
     /**
-     * Disables the timeout.
+     * Diagnostic builds measure the IRQ handlers (@see telemetry.hpp).
      */
-    void disable();
+    constexpr bool TELEMETRY = false;
 
     /**
-     * Checks if the timeout timer has elapsed.
-     * A disabled timer never elapses.
-     * @return true if the timer has elapsed, false otherwise.
+     * The number of smart-display modules chained after the game display,
+     * in store-and-forward mode, on which the track continues (@see link.hpp).
      */
-    bool elapsed();
+    constexpr uint8_t CHAIN_MODULES = 0;
 
-    /**
-     * Gets the number of ticks remaining before the timeout timer elapses.
-     * @return The number of ticks remaining or 0 if elapsed or disabled.
-     */
-    uint8_t remaining_ticks();
 }
 
-#endif	/* TIMER_HPP_INCLUDED */
+#endif /* CONFIG_HPP_INCLUDED */
@@ -26,12 +26,15 @@
 
 #include <avr/pgmspace.h>
 
+#include "config.hpp"
 #include "cpu.hpp"
 #include "display.hpp"
 #include "game.hpp"
 #include "game_ui.hpp"
 #include "game_vm.hpp"
 #include "key.hpp"
+#include "link.hpp"
+#include "recorder.hpp"
 #include "timer.hpp"
 #include "utilities.hpp"
 
@@ -51,93 +54,234 @@ static const char score_suffix[] PROGMEM = {
     'a', 'g', 'a', 'i', 'n', ' ',
 };
 
-inline void demo_loop() {
-    str_builder str;
-    str.append_progmem(start_text, sizeof(start_text));
+/**
+ * The schedule of the VM tick events, on the RTC clock.
+ * The deadlines keep the fraction of the VM wait time, so they do not drift.
+ */
+static struct {
+    uint16_t deadline;
+    uint8_t fraction;
 
-    for (;;) {
-        if (ui::display_string( str.text() )) return;
-        uint8_t loops = 20;
+    void advance() {
+        constexpr uint8_t mask = (1 << vm::WAIT_FRACTION_BITS) - 1;
+        const uint16_t wait = vm::wait_time();
+        const uint8_t sum = fraction + (wait & mask);
+        deadline += (wait >> vm::WAIT_FRACTION_BITS) + (sum >> vm::WAIT_FRACTION_BITS);
+        fraction = sum & mask;
+    }
 
-        vm::reset(50);
-        vm::tick_event();
-        timer::enable( vm::wait_ticks() );
-        while (loops) {
-            key::run();
-            if (key::changed() && key::state() == key::state_t::pressed) return;
+    void start() {
+        deadline = timer::clock();
+        fraction = 0;
+        advance();
+    }
 
-            if (timer::remaining_ticks() < 5) {
-                if (vm::may_steer_safely() && ((timer::ticks() & 0xF) < 4)) {
-                    if (!vm::steer_event()) break;
+    bool elapsed() const {
+        return timer::reached(timer::clock(), deadline);
+    }
 
-                    timer::enable( vm::wait_ticks() );
+    uint16_t remaining() const {
+        const int16_t counts = deadline - timer::clock();
+        return counts > 0 ? counts : 0;
+    }
+} schedule;
 
-                    --loops;
-                }
-            }
+/**
+ * The phases of the game, resumed by the scheduler at each event.
+ */
+enum class phase: uint8_t {
+    demo_text,      // the invitation to play scrolls
+    demo_race,      // the VM plays by itself
+    countdown,      // the game is about to start
+    race,           // the player drives
+    crash,          // the remaining cars flash
+    score,          // the score scrolls
+    release_game,   // a game starts when the key is released
+    release_score,  // the score shows when the key is released
+};
 
-            if (timer::elapsed()) {
-                vm::tick_event();
-                timer::enable( vm::wait_ticks() );
-            }
-            // TODO: idle CPU
-        }
-    }
+/**
+ * The speed of the VM at the start of a game.
+ */
+constexpr uint8_t GAME_START_SPEED = 0;
+
+static phase current;
+static str_builder text;
+static uint8_t demo_loops;
+
+inline void start_demo() {
+    text.clear();
+    text.append_progmem(start_text, sizeof(start_text));
+    ui::show_string(text.text());
+    current = phase::demo_text;
 }
 
-inline void play_game() {
+inline void start_demo_race() {
+    demo_loops = 20;
+    vm::reset(12);
     vm::tick_event();
-    timer::enable( vm::wait_ticks() );
-    for (;;) {
-        key::run();
-        if (key::changed() && key::state() == key::state_t::pressed) {
-            if (!vm::steer_event()) return;
-        }
-        if (timer::elapsed()) {
-            vm::tick_event();
-            timer::enable( vm::wait_ticks() );
-        }
-        // TODO: idle CPU
-    }
+    schedule.start();
+    current = phase::demo_race;
+}
+
+inline void start_game() {
+    vm::reset(GAME_START_SPEED);
+    recorder::start(GAME_START_SPEED);
+    ui::show_countdown(3);
+    current = phase::countdown;
+}
+
+/**
+ * Ticks the VM during the race, which is recorded.
+ */
+inline void race_tick() {
+    vm::tick_event();
+    recorder::tick();
 }
 
-inline void game_loop() {
-    vm::reset();
-    ui::display_countdown(3);
-    for (;;) {
-        play_game();
-        ui::display_flashing_digit( vm::remaining_cars() );
-        if (vm::game_over()) break;
+inline void start_race() {
+    race_tick();
+    schedule.start();
+    current = phase::race;
+}
+
+inline void start_score() {
+    text.clear();
+    text.append_progmem(score_prefix, sizeof(score_prefix));
+    text.append_uint( vm::score() );
+    text.append_progmem(score_suffix, sizeof(score_suffix));
+    ui::show_string(text.text());
+    current = phase::score;
+}
+
+inline void run_vm() {
+    if (schedule.elapsed()) {
+        vm::tick_event();
+        schedule.advance();
     }
 }
 
-inline void score_loop() {
-    str_builder str;
+/**
+ * Steers at a key press during the race.
+ * Steering is judged at the time of the key press,
+ * even if the scheduler sees it after the deadline.
+ */
+inline void steer(uint16_t time) {
+    const int16_t slack = schedule.deadline - time;
+    if (timer::reached(time, schedule.deadline)) {
+        race_tick();
+        schedule.advance();
+    }
+    recorder::steer(slack);
+    if (!vm::steer_event()) {
+        if (vm::game_over()) recorder::stop(vm::score());
+        ui::show_flashing_digit( vm::remaining_cars() );
+        current = phase::crash;
+    }
+}
 
-    str.append_progmem(score_prefix, sizeof(score_prefix));
-    str.append_uint( vm::score() );
-    str.append_progmem(score_suffix, sizeof(score_suffix));
+inline void demo_step() {
+    if (schedule.remaining() < 5 * timer::COUNTS_PER_TICK) {
+        if (vm::may_steer_safely() && ((timer::ticks() & 0xF) < 4)) {
+            if (!vm::steer_event()) {
+                start_demo();
+                return;
+            }
+            schedule.start();
+            if (--demo_loops == 0) {
+                start_demo();
+                return;
+            }
+        }
+    }
+    run_vm();
+}
 
-    while (!ui::display_string( str.text() )) ;
+/**
+ * Resumes the current phase.
+ * @param pressed true if the key was pressed since the last step.
+ */
+static void step(bool pressed) {
+    switch (current) {
+        case phase::demo_text:
+            switch (ui::resume(pressed)) {
+                case ui::status::pressed: current = phase::release_game; break;
+                case ui::status::done: start_demo_race(); break;
+                default: break;
+            }
+            break;
+        case phase::demo_race:
+            if (pressed) {
+                current = phase::release_game;
+            } else {
+                demo_step();
+            }
+            break;
+        case phase::countdown:
+            // the key presses before the race do not steer
+            if (ui::resume(false) == ui::status::done) start_race();
+            break;
+        case phase::race:
+            if (schedule.elapsed()) {
+                race_tick();
+                schedule.advance();
+            }
+            break;
+        case phase::crash:
+            if (ui::resume(pressed) != ui::status::running) {
+                if (vm::game_over()) {
+                    current = phase::release_score;
+                } else {
+                    start_race();
+                }
+            }
+            break;
+        case phase::score:
+            switch (ui::resume(pressed)) {
+                case ui::status::pressed: current = phase::release_game; break;
+                case ui::status::done: ui::show_string(text.text()); break;
+                default: break;
+            }
+            break;
+        case phase::release_game:
+            if (key::state() == key::state_t::released) start_game();
+            break;
+        case phase::release_score:
+            if (key::state() == key::state_t::released) start_score();
+            break;
+    }
 }
 
 namespace game {
 
     void init() {
+        cpu::setup_clock();
         cpu::irq_roundrobin();
         timer::init();
         key::init();
         display::init();
+        if (config::CHAIN_MODULES) link::init();
+        // holding the key at power-on dumps the last game
+        if (key::state() == key::state_t::pressed) recorder::dump();
     }
 
     void run() {
-        demo_loop();
-        ui::wait_key_released();
+        start_demo();
         for (;;) {
-            game_loop();
-            ui::wait_key_released();
-            score_loop();
-            ui::wait_key_released();
+            bool pressed = false;
+            key::event event;
+            while (key::next(event)) {
+                if (event.state != key::state_t::pressed) continue;
+                if (current == phase::race) {
+                    steer(event.time);
+                } else {
+                    pressed = true;
+                }
+            }
+            step(pressed);
+            recorder::run();
+            // any IRQ may be an event: the key, the RTC or the display
+            cpu::idle();
         }
     }
 }
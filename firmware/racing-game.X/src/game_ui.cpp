@@ -24,7 +24,6 @@
  * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <avr/pgmspace.h>
 #include <stdint.h>
 
 #include "display.hpp"
@@ -32,83 +31,170 @@
 #include "key.hpp"
 #include "timer.hpp"
 
-constexpr uint8_t FLASH_SPEED = 5;
+constexpr uint8_t FLASH_TICKS = 5;
+constexpr uint8_t SECOND_TICKS = timer::TICKS_PER_SEC;
+constexpr uint8_t CHAR_TICKS = timer::TICKS_PER_SEC / 2;
+constexpr uint8_t BLANK_TICKS = 1;
 
-namespace ui {
+/*
+ * The event raised by the timer when a screen wakes up.
+ */
+constexpr uint8_t WAKE_EVENT = 0x01;
+
+constexpr uint8_t COUNTDOWN_FLASHES = 10;
+constexpr uint8_t DIGIT_FLASHES = 20;
+
+enum class screen: uint8_t {
+    none = 0,
+    countdown,
+    flashing_digit,
+    string,
+};
 
-    void wait_key_released() {
-        while (key::state() == key::state_t::pressed) key::run();
+/**
+ * The points where the screens resume.
+ */
+enum class step: uint8_t {
+    start = 0,
+    show,  // the character is shown until the screen wakes up
+    blank, // the display is off until the screen wakes up
+};
+
+static struct {
+    screen shown;
+    step next;
+    char code;       // the digit shown
+    uint8_t count;   // the countdown
+    uint8_t flashes; // the flashes left or shown
+    const char* text;
+    timer::timeout_id wake = timer::NO_TIMEOUT; // when awake
+
+    void start(screen s) {
+        shown = s;
+        next = step::start;
+        timer::cancel(wake);
+        wake = timer::NO_TIMEOUT;
+        timer::take_events(WAKE_EVENT);
     }
 
-    bool wait_key_pressed_or_timer_elapsed() {
-        do {
-            key::run();
-            if (key::changed() && key::state() == key::state_t::pressed) return true;
-            // TODO: idle CPU
-        } while (!timer::elapsed());
-        return false;
+    /**
+     * Sleeps until the timer raises the wake event. The screens sleep
+     * again as soon as they wake up, in the tick of the event, so the
+     * animations do not drift.
+     */
+    void sleep(uint8_t ticks) {
+        wake = timer::signal_after(ticks, WAKE_EVENT);
     }
 
-    void display_countdown(uint8_t count) {
-        if (count > 10) count = 9;
+    bool awake() {
+        // a screen that could not get a timeout does not wait
+        if (wake != timer::NO_TIMEOUT && !timer::take_events(WAKE_EVENT)) return false;
+        wake = timer::NO_TIMEOUT;
+        return true;
+    }
 
-        uint8_t ticks = timer::TICKS_PER_SEC / FLASH_SPEED;
+    ui::status end(ui::status result) {
+        shown = screen::none;
+        return result;
+    }
 
-        display::show_char(count ? '0' + count : ' ');
-        timer::enable(count ? timer::TICKS_PER_SEC : FLASH_SPEED);
-        for (;;) {
-            key::run();
-            if (timer::elapsed()) {
-                if (count && --count) {
-                    timer::enable(timer::TICKS_PER_SEC);
-                    display::show_char('0' + count);
-                } else {
-                    timer::enable(FLASH_SPEED);
-                    display::show_char(ticks & 1 ? '0' + count : ' ');
-                    if (--ticks == 0) return;
-                }
-            }
-            // TODO: idle CPU
+    ui::status resume_countdown() {
+        if (!awake()) return ui::status::running;
+        if (count && --count) {
+            sleep(SECOND_TICKS);
+            display::show_char('0' + count);
+        } else {
+            sleep(FLASH_TICKS);
+            display::show_char(flashes & 1 ? '0' : ' ');
+            if (--flashes == 0) return end(ui::status::done);
         }
+        return ui::status::running;
     }
 
-    void display_flashing_digit(uint8_t value) {
-        if (value > 10) value = 9;
-        wait_key_released();
+    ui::status resume_flashing_digit(bool pressed) {
+        if (next == step::start) {
+            // the press that ended the game is not an answer
+            if (key::state() == key::state_t::pressed) return ui::status::running;
+            display::show_char(code);
+            sleep(FLASH_TICKS);
+            flashes = 0;
+            next = step::show;
+            return ui::status::running;
+        }
+        if (pressed) {
+            display::off();
+            return end(ui::status::pressed);
+        }
+        if (!awake()) return ui::status::running;
+        sleep(FLASH_TICKS);
+        display::show_char(flashes & 1 ? code : ' ');
+        if (++flashes == DIGIT_FLASHES) {
+            display::off();
+            return end(ui::status::done);
+        }
+        return ui::status::running;
+    }
 
-        uint8_t tick = 0;
-        timer::enable(FLASH_SPEED);
-        display::show_char('0' + value);
+    ui::status resume_string(bool pressed) {
+        if (pressed) return end(ui::status::pressed);
         for (;;) {
-            key::run();
-            if (key::changed() && key::state() == key::state_t::pressed) break;
-            if (timer::elapsed()) {
-                timer::enable(FLASH_SPEED);
-                display::show_char(tick & 1 ? '0' + value : ' ');
-                ++tick;
-                if (tick == 20) break;
+            switch (next) {
+                case step::start: {
+                    const char c = *text++;
+                    if (!c) return end(ui::status::done);
+                    display::show_char(c);
+                    sleep(CHAR_TICKS);
+                    next = step::show;
+                    break;
+                }
+                case step::show:
+                    if (!awake()) return ui::status::running;
+                    display::off();
+                    sleep(BLANK_TICKS);
+                    next = step::blank;
+                    break;
+                case step::blank:
+                    if (!awake()) return ui::status::running;
+                    next = step::start;
+                    break;
             }
-            // TODO: idle CPU
         }
-        display::off();
     }
 
-    bool display_char(char code) {
-        display::show_char(code);
+} state;
+
+namespace ui {
+
+    void show_countdown(uint8_t count) {
+        if (count > 10) count = 9;
+        state.start(screen::countdown);
+        state.count = count;
+        state.flashes = COUNTDOWN_FLASHES;
+        display::show_char(count ? '0' + count : ' ');
+        state.sleep(count ? SECOND_TICKS : FLASH_TICKS);
+    }
+
+    void show_flashing_digit(uint8_t value) {
+        if (value > 10) value = 9;
+        state.start(screen::flashing_digit);
+        state.code = '0' + value;
+    }
 
-        timer::enable(timer::TICKS_PER_SEC >> 1);
-        if (wait_key_pressed_or_timer_elapsed()) return true;
-        display::off();
-        timer::enable(1);
-        return wait_key_pressed_or_timer_elapsed();
+    void show_string(const char* text) {
+        state.start(screen::string);
+        state.text = text;
     }
 
-    bool display_string(const char* text) {
-        char code = *text++;
-        while (code) {
-            if (display_char(code)) return true;
-            code = *text++;
+    status resume(bool pressed) {
+        switch (state.shown) {
+            case screen::countdown:
+                return state.resume_countdown();
+            case screen::flashing_digit:
+                return state.resume_flashing_digit(pressed);
+            case screen::string:
+                return state.resume_string(pressed);
+            default:
+                return status::done;
         }
-        return false;
     }
 }
@@ -29,53 +29,54 @@
 
 #include <stdint.h>
 
+/**
+ * The screens of the game, as stackless coroutines: a screen is started,
+ * then resumed by the scheduler of the game at each event
+ * (@see game::run()). A resumed screen returns at once, so the screens
+ * never own the CPU and the VM keeps running between their steps.
+ * One screen is shown at a time, a new one replaces it.
+ */
 namespace ui {
 
     /**
-     * Loops until the key is released.
-     * Does not reset the key changed flag.
-     */
-    extern void wait_key_released();
-
-    /**
-     * Waits for key pressed or timer elapsed.
-     * @return true if key pressed, false if timer elapsed.
+     * The outcome of a screen.
      */
-    extern bool wait_key_pressed_or_timer_elapsed();
+    enum class status: uint8_t {
+        running, // the screen waits for an event
+        done,    // the animation or the text ended
+        pressed, // the key was pressed
+    };
 
     /**
-     * Displays a countdown from the given value to 0.
+     * Shows a countdown from the given value to 0.
      * Key is ignored.
      * @param count The number to start from.
      *              Value is clamped to the interval [0..9].
      */
-    extern void display_countdown(uint8_t count);
+    void show_countdown(uint8_t count);
 
     /**
-     * Displays a single digit flashing.
+     * Shows a single digit flashing, once the key is released.
      * The animation ends when the key is pressed or after a while.
      * @param value The number to display.
      *              Value is clamped to the interval [0..9].
      */
-    extern void display_flashing_digit(uint8_t value);
+    void show_flashing_digit(uint8_t value);
 
     /**
-     * Displays a character for half a second.
-     * Key is checked.
-     * @param code The character code to display.
-     * @return true if the key was pressed, false otherwise.
+     * Shows each character of a string in sequence for half a second
+     * until the key is pressed or the string is terminated.
+     * @param text The text to display as a NUL-terminated string.
+     *             String must be in RAM until the screen ends.
      */
-    extern bool display_char(char code);
+    void show_string(const char* text);
 
     /**
-     * Displays each character of a string in sequence for half a second
-     * until the key is pressed or the string is terminated.
-     * Key is checked.
-     * @param text The text to display as a NUL-terminated string.
-     *             String must be in RAM.
-     * @return true if the key was pressed, false otherwise.
+     * Resumes the screen until it waits for the next event.
+     * @param pressed true if the key was pressed since the last call.
+     * @return The outcome of the screen, status::done if none is shown.
      */
-    extern bool display_string(const char* text);
+    status resume(bool pressed);
 }
 
 #endif	/* GAME_UI_HPP_DEFINED */
@@ -26,113 +26,232 @@
 
 #include <avr/pgmspace.h>
 
+#include "config.hpp"
 #include "cpu.hpp"
 #include "display.hpp"
 #include "game_vm.hpp"
+#include "link.hpp"
+#include "timer.hpp"
+#include "track.hpp"
 #include "utilities.hpp"
 
+/**
+ * The number of moves per second at the lowest and the highest speed.
+ * The rate grows linearly with the speed in between.
+ */
+constexpr uint8_t MIN_MOVES_PER_SEC = 2;
+constexpr uint8_t MAX_MOVES_PER_SEC = 40;
+
+constexpr uint16_t wait_time(uint8_t speed) {
+    return ((uint32_t)timer::COUNTS_PER_SEC * 255 << vm::WAIT_FRACTION_BITS)
+        / ((uint16_t)MIN_MOVES_PER_SEC * 255 + (uint16_t)(MAX_MOVES_PER_SEC - MIN_MOVES_PER_SEC) * speed);
+}
+
+static_assert(((uint32_t)timer::COUNTS_PER_SEC << vm::WAIT_FRACTION_BITS) / MIN_MOVES_PER_SEC <= 0xFFFF,
+    "wait time overflow at the lowest speed");
+static_assert(wait_time(254) > wait_time(255), "wait time too coarse at the highest speed");
+static_assert(2 * (uint32_t)link::FRAME_US * timer::COUNTS_PER_SEC / 1000000
+    < wait_time(255) >> vm::WAIT_FRACTION_BITS, "two link frames must fit in a move at the highest speed");
+
 enum vm_result: uint8_t {
     vm_pause = 0,
     vm_exec,
     vm_stop,
 };
 
-enum vm_opcode: uint8_t {
-    op_jump = 0,  // PC = next_pc(), fetch, exec tick
+using namespace track;
+
+/**
+ * The track: two loops around the digit, in opposite directions,
+ * connected by turns across the middle segment (@see track.hpp).
+ */
+constexpr char TRACK[] =
+    "clockwise: b>turn_b clockwise_c: c d e>turn_e f a @clockwise "
+    "turn_b: g e d counterclockwise: c>turn_c b a counterclockwise_f: f>turn_f e d @counterclockwise "
+    "turn_c: g f a @clockwise "
+    "turn_e: g b a @counterclockwise_f "
+    "turn_f: g @clockwise_c ";
+
+/**
+ * The text of a track generated for a number of modules.
+ */
+template <uint16_t N>
+struct track_text {
+    char chars[N];
+    uint16_t length;
+
+    constexpr void append(const char* word) {
+        while (*word) chars[length++] = *word++;
+    }
 
-    op_a,     // turn on segment a, increment PC, steer (vm_next != 0), pause
-    op_b,     // turn on segment b, increment PC, steer (vm_next != 0), pause
-    op_c,     // turn on segment c, increment PC, steer (vm_next != 0), pause
-    op_d,     // turn on segment d, increment PC, steer (vm_next != 0), pause
-    op_e,     // turn on segment e, increment PC, steer (vm_next != 0), pause
-    op_f,     // turn on segment f, increment PC, steer (vm_next != 0), pause
-    op_g,     // turn on segment g, increment PC, steer (vm_next != 0), pause
+    constexpr void append(uint8_t number) {
+        if (number >= 10) append((uint8_t)(number / 10));
+        chars[length++] = '0' + number % 10;
+    }
 
-    // on failed steer: decrement cars, reset speed, PC = 0, fetch, stop VM
-    // on successful steer: increment score, recompute speed, PC = next_pc(), fetch, exec_tick
+    constexpr void append(const char* word, uint8_t number, const char* suffix = " ") {
+        append(word);
+        append(number);
+        append(suffix);
+    }
 };
 
-constexpr uint8_t vm_instruction(const vm_opcode on_tick, const int8_t next_pc) {
-    return (on_tick << 5) | next_pc;
-}
+constexpr uint8_t MAX_CHAIN_MODULES = 16;
+constexpr uint16_t CHAIN_TRACK_LENGTH = 96 * (MAX_CHAIN_MODULES + 1);
+
+static_assert(config::CHAIN_MODULES <= MAX_CHAIN_MODULES, "too many modules for the chain track");
+
+/**
+ * The track across a chain of M modules: a ring along the border of the
+ * modules, clockwise, and a lane across their middle segments.
+ * The car may turn down to the middle lane at the right end of each top
+ * segment, and up to it at the left end of each bottom segment;
+ * the middle lane rejoins the ring at the right end of the chain.
+ */
+template <uint8_t M>
+constexpr track_text<CHAIN_TRACK_LENGTH> chain_track() {
+    track_text<CHAIN_TRACK_LENGTH> text {};
+
+    // top lane, left to right
+    text.append("outer: ");
+    for (uint8_t k = 0; k + 1 < M; ++k) {
+        text.append("#", k);
+        text.append("a>down", k);
+    }
+    text.append("#", M - 1);
+    text.append("a b right: c ");
+    // bottom lane, right to left
+    for (uint8_t k = M - 1; k > 0; --k) {
+        text.append("#", k);
+        text.append("d>up", k);
+    }
+    text.append("#0 d e f @outer ");
+    // turns down to the middle lane
+    for (uint8_t k = 0; k + 1 < M; ++k) {
+        text.append("down", k, ": ");
+        text.append("#", k);
+        text.append("b @mid", k + 1);
+    }
+    // turns up to the middle lane
+    for (uint8_t k = 1; k < M; ++k) {
+        text.append("up", k, ": ");
+        text.append("#", k - 1);
+        text.append("c @mid", k);
+    }
+    // middle lane, left to right
+    for (uint8_t k = 1; k < M; ++k) {
+        text.append("mid", k, ": ");
+        text.append("#", k);
+        text.append("g ");
+    }
+    text.append("@right ");
 
-inline vm_opcode get_opcode(uint8_t instruction) {
-    return static_cast<vm_opcode>(instruction >> 5);
+    return text;
 }
 
-inline uint8_t get_next_pc(uint8_t instruction) {
-    return instruction & 0x01F;
+constexpr track_text<CHAIN_TRACK_LENGTH> CHAIN_TRACK = chain_track<config::CHAIN_MODULES + 1>();
+
+constexpr const char* TRACK_TEXT = config::CHAIN_MODULES ? CHAIN_TRACK.chars : TRACK;
+
+constexpr uint16_t TRACK_SIZE = track::size(TRACK_TEXT);
+constexpr program<TRACK_SIZE> TRACK_PROGRAM = compile<TRACK_SIZE>(TRACK_TEXT);
+
+static_assert(TRACK_PROGRAM.status != error::syntax, "track: invalid token");
+static_assert(TRACK_PROGRAM.status != error::duplicate_label, "track: duplicate label");
+static_assert(TRACK_PROGRAM.status != error::unknown_label, "track: unknown label");
+static_assert(TRACK_PROGRAM.status != error::turn_to_start, "track: turn to the first instruction");
+static_assert(TRACK_PROGRAM.status != error::too_long, "track: too many instructions");
+static_assert(TRACK_PROGRAM.status != error::off_end, "track: the last segment runs past the end");
+static_assert(TRACK_PROGRAM.status != error::unreachable, "track: unreachable instruction");
+static_assert(TRACK_PROGRAM.status != error::no_segment, "track: loop of jumps");
+static_assert(TRACK_PROGRAM.status != error::no_exit, "track: loop without turns");
+static_assert(TRACK_PROGRAM.status != error::not_adjacent, "track: consecutive segments do not touch");
+static_assert(TRACK_PROGRAM.status != error::wrong_way, "track: segment driven both ways");
+static_assert(TRACK_PROGRAM.status == error::none, "track: invalid");
+
+static const program<TRACK_SIZE> vm_program PROGMEM = TRACK_PROGRAM;
+
+/**
+ * A CRC-16 (CCITT) of the track program, which identifies the track.
+ */
+template <uint16_t N>
+constexpr uint16_t program_crc(const program<N>& p) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t pc = 0; pc < N; ++pc) {
+        for (uint8_t shift = 16; shift; ) {
+            shift -= 8;
+            crc ^= (uint16_t)(uint8_t)(p.code[pc] >> shift) << 8;
+            for (uint8_t i = 0; i < 8; ++i) {
+                crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
+        }
+    }
+    return crc;
 }
 
-const uint8_t vm_program[] PROGMEM = {
-/*  0: */ vm_instruction(op_b,     7), // on steer, goto 7
-/*  1: */ vm_instruction(op_c,     0),
-/*  2: */ vm_instruction(op_d,     0),
-/*  3: */ vm_instruction(op_e,    21), // on steer, goto 21
-/*  4: */ vm_instruction(op_f,     0),
-/*  5: */ vm_instruction(op_a,     0),
-/*  6: */ vm_instruction(op_jump,  0), // goto 0
-/*  7: */ vm_instruction(op_g,     0),
-/*  8: */ vm_instruction(op_e,     0),
-/*  9: */ vm_instruction(op_d,     0),
-/* 10: */ vm_instruction(op_c,    17), // on steer, goto 17
-/* 11: */ vm_instruction(op_b,     0),
-/* 12: */ vm_instruction(op_a,     0),
-/* 13: */ vm_instruction(op_f,    25), // on steer, goto 25
-/* 14: */ vm_instruction(op_e,     0),
-/* 15: */ vm_instruction(op_d,     0),
-/* 16: */ vm_instruction(op_jump, 10), // goto 10
-/* 17: */ vm_instruction(op_g,     0),
-/* 18: */ vm_instruction(op_f,     0),
-/* 19: */ vm_instruction(op_a,     0),
-/* 20: */ vm_instruction(op_jump,  0), // goto 0
-/* 21: */ vm_instruction(op_g,     0),
-/* 22: */ vm_instruction(op_b,     0),
-/* 23: */ vm_instruction(op_a,     0),
-/* 24: */ vm_instruction(op_jump, 13), // goto 13
-/* 25: */ vm_instruction(op_g,     0),
-/* 26: */ vm_instruction(op_jump,  1), // goto 1
-};
+constexpr uint16_t TRACK_ID = program_crc(TRACK_PROGRAM);
 
 static struct {
     uint16_t score;
     uint8_t cars;  // number of cars before game over
     uint8_t speed; // abstract scale from 0 to 255
-    uint8_t ticks; // ticks to wait before executing another instruction
+    uint16_t wait; // time to wait before executing another instruction (@see vm::wait_time())
 
-    uint8_t pc;
-    uint8_t instruction;
+    uint16_t pc;
+    uint16_t instruction;
+    uint8_t module;       // the module of the next segments
+    uint8_t shown_module; // the module that shows the car
 
-    void update_ticks() {
-        if (speed < 80) {
-            ticks = 25 - (speed >> 2); // 25..5
-        } else if (speed < 128) {
-            ticks = 10 - (speed >> 4); // 5..2
+    void render(uint8_t target, uint8_t segments) {
+        if (target == 0) {
+            display::show_segments(segments);
         } else {
-            ticks = 2;
+            link::show_segments(target - 1, segments);
+        }
+    }
+
+    void show(uint8_t segments) {
+        if (module != shown_module) {
+            render(shown_module, 0);
+            shown_module = module;
         }
+        render(module, segments);
+    }
+
+    /**
+     * Moves the car back to the game display, where the crash is shown.
+     */
+    void return_home() {
+        if (shown_module != 0) render(shown_module, 0);
+        module = 0;
+        shown_module = 0;
+    }
+
+    void update_wait() {
+        wait = ::wait_time(speed);
     }
 
     inline void update_speed() {
         if (speed == 255) return;
         ++speed;
-        update_ticks();
+        update_wait();
     }
 
     inline void fetch() {
-        instruction = pgm_read_byte(vm_program + pc);
+        instruction = pgm_read_word(vm_program.code + pc);
     }
 
     void reset(uint8_t start_speed) {
         score = 0;
         cars = 3;
         speed = start_speed;
-        update_ticks();
+        update_wait();
         pc = 0;
+        return_home();
     }
 
     vm_result exec() {
-        const vm_opcode op = get_opcode(instruction);
+        const opcode op = get_opcode(instruction);
 
         switch (op) {
             case op_jump:
@@ -140,33 +259,38 @@ static struct {
                 fetch();
                 return vm_exec;
             case op_a:
-                display::show_segments(display::segment::a);
+                show(display::segment::a);
                 pc += 1;
                 return vm_pause;
             case op_b:
-                display::show_segments(display::segment::b);
+                show(display::segment::b);
                 pc += 1;
                 return vm_pause;
             case op_c:
-                display::show_segments(display::segment::c);
+                show(display::segment::c);
                 pc += 1;
                 return vm_pause;
             case op_d:
-                display::show_segments(display::segment::d);
+                show(display::segment::d);
                 pc += 1;
                 return vm_pause;
             case op_e:
-                display::show_segments(display::segment::e);
+                show(display::segment::e);
                 pc += 1;
                 return vm_pause;
             case op_f:
-                display::show_segments(display::segment::f);
+                show(display::segment::f);
                 pc += 1;
                 return vm_pause;
             case op_g:
-                display::show_segments(display::segment::g);
+                show(display::segment::g);
                 pc += 1;
                 return vm_pause;
+            case op_module:
+                module = get_next_pc(instruction);
+                pc += 1;
+                fetch();
+                return vm_exec;
         }
 
         // invalid opcode!
@@ -185,7 +309,8 @@ static struct {
         } else {
             if (cars > 0) --cars;
             speed = 0;
-            update_ticks();
+            update_wait();
+            return_home();
             return vm_stop;
         }
     }
@@ -198,8 +323,12 @@ namespace vm {
         state.reset(start_speed);
     }
 
-    uint8_t wait_ticks() {
-        return state.ticks;
+    uint16_t wait_time() {
+        return state.wait;
+    }
+
+    uint16_t track_id() {
+        return TRACK_ID;
     }
 
     void tick_event() {
@@ -39,10 +39,24 @@ namespace vm {
     void reset(uint8_t start_speed = 0);
 
     /**
-     * Gets the number of ticks to wait before the next tick event.
-     * @return The number of ticks to wait.
+     * The number of fraction bits of the wait time.
      */
-    uint8_t wait_ticks();
+    constexpr uint8_t WAIT_FRACTION_BITS = 4;
+
+    /**
+     * Gets the time to wait before the next tick event.
+     * It shortens smoothly as the speed increases.
+     * @return The time to wait in RTC counts (@see timer::COUNTS_PER_SEC),
+     *         fixed-point with WAIT_FRACTION_BITS fraction bits.
+     */
+    uint16_t wait_time();
+
+    /**
+     * Identifies the track, so that a game record is replayed
+     * with the same track (@see recorder.hpp).
+     * @return A checksum of the track program.
+     */
+    uint16_t track_id();
 
     /**
      * Reacts to a tick event.
@@ -0,0 +1,119 @@
+/* 
+ * File:   link.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "cpu.hpp"
+#include "link.hpp"
+#include "protocol.hpp"
+
+/**
+ * The size of the TX queue, a power of 2 holding a few frames.
+ */
+constexpr uint8_t TX_QUEUE_SIZE = 16;
+
+static_assert(TX_QUEUE_SIZE >= 2 * link::FRAME_UNITS, "the TX queue must hold two frames");
+
+static volatile uint8_t tx_queue[TX_QUEUE_SIZE];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+
+static bool inited;
+
+inline void setup_ports() {
+	// Configure port MUX to use UART's alternate pins.
+	PORTMUX.CTRLB |= PORTMUX_USART0_ALTERNATE_gc;
+	// Configure PA4 (CCLO output) to output 1.
+	PORTA.OUTSET = PIN4_bm;
+	// Configure as output: PA1 (UART TX alternate), PA4 (CCLO output).
+	PORTA.DIRSET = PIN1_bm | PIN4_bm;
+}
+
+inline void setup_ccl() {
+	CCL.TRUTH0 = 0xAA; // IN0=0 -> OUT=0, IN0=1 -> OUT=1 (CCLO mirrors TX)
+	CCL.LUT0CTRLC = CCL_INSEL2_MASK_gc;
+	CCL.LUT0CTRLB = CCL_INSEL1_MASK_gc | CCL_INSEL0_USART0_gc;
+	CCL.LUT0CTRLA = CCL_OUTEN_bm | CCL_ENABLE_bm;
+	CCL.CTRLA = CCL_RUNSTDBY_bm | CCL_ENABLE_bm;
+}
+
+inline void setup_usart() {
+	USART0.BAUD = protocol::uart_baud(link::BPS);
+	USART0.CTRLC = USART_PMODE_DISABLED_gc | USART_CHSIZE_8BIT_gc;
+	USART0.CTRLB = USART_TXEN_bm;
+	// TX is driven by the DRE IRQ when the queue is not empty
+	USART0.CTRLA = 0;
+}
+
+ISR(USART0_DRE_vect) {
+    USART0.TXDATAL = tx_queue[tx_tail];
+    tx_tail = (tx_tail + 1) & (TX_QUEUE_SIZE - 1);
+    if (tx_tail == tx_head) USART0.CTRLA &= ~USART_DREIE_bm;
+}
+
+static void enqueue(uint8_t unit) {
+    const uint8_t head = tx_head;
+    const uint8_t next = (head + 1) & (TX_QUEUE_SIZE - 1);
+    // the queue is full: wait for the DRE IRQ to take a unit
+    while (next == tx_tail) cpu::idle();
+    tx_queue[head] = unit;
+    tx_head = next;
+    USART0.CTRLA |= USART_DREIE_bm;
+}
+
+static uint8_t send(uint8_t crc, uint8_t unit) {
+    enqueue(unit);
+    return protocol::crc8(crc, unit);
+}
+
+namespace link {
+
+    void init() {
+        // ensure that initialisation is done once
+        if (inited) return;
+
+        setup_ports();
+        setup_ccl();
+        setup_usart();
+
+        inited = true;
+    }
+
+    void show_segments(uint8_t module, uint8_t segments) {
+        uint8_t crc = 0;
+        crc = send(crc, protocol::code::segs);
+        crc = send(crc, module);
+        crc = send(crc, segments);
+        send(crc, protocol::code::check);
+        send(0, crc);
+    }
+
+    void write(uint8_t unit) {
+        enqueue(unit);
+    }
+
+}
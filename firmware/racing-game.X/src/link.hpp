@@ -0,0 +1,82 @@
+/* 
+ * File:   link.hpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LINK_HPP_DEFINED
+#define	LINK_HPP_DEFINED
+
+#include <stdint.h>
+
+/**
+ * The link to a chain of smart-display modules, in store-and-forward mode,
+ * on which the game draws the parts of the track beyond its own display.
+ * Each frame is a SEGS command committed at once by a CHECK command,
+ * so the modules do not wait for the protocol timeout.
+ */
+namespace link {
+
+    /**
+     * The speed of the link in bits per second,
+     * the default speed of the smart-display modules.
+     */
+    constexpr uint16_t BPS = 19200;
+
+    /**
+     * The number of message units of a frame: SEGS o m, CHECK crc.
+     */
+    constexpr uint8_t FRAME_UNITS = 5;
+
+    /**
+     * The transmission time of a frame in microseconds (8N1 framing).
+     */
+    constexpr uint16_t FRAME_US = (uint32_t)FRAME_UNITS * 10 * 1000000 / BPS;
+
+    /**
+     * Initialises the hardware resources related to the link.
+     * GPIO: PA1, PA4.
+     * USART: USART0 (TX only).
+     * CCL: LUT0, its output mirrors TX.
+     */
+    void init();
+
+    /**
+     * Sends a frame that shows segments on a module of the chain.
+     * Waits only if the previous frames are still queued.
+     * @param module The index of the module, 0 for the first one after the game.
+     * @param segments The segment map (@see display::segment).
+     */
+    void show_segments(uint8_t module, uint8_t segments);
+
+    /**
+     * Sends a raw unit, not a command of the modules
+     * (@see recorder::dump()).
+     * Waits only if the previous units are still queued.
+     * @param unit The unit to send.
+     */
+    void write(uint8_t unit);
+
+}
+
+#endif	/* LINK_HPP_DEFINED */
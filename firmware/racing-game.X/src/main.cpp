@@ -34,6 +34,7 @@ int main (void) {
 //    test::timer_ticks();
 //    test::timer_seconds();
 //    test::timer_elapsed();
+//    test::timer_timeouts();
 //    test::key_states();
 
     game::init();
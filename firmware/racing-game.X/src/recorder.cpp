@@ -0,0 +1,125 @@
+/* 
+ * File:   recorder.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <avr/eeprom.h>
+#include <stdint.h>
+
+#include "game_vm.hpp"
+#include "link.hpp"
+#include "protocol.hpp"
+#include "recorder.hpp"
+
+static recorder::record EEMEM saved_record;
+
+static recorder::record current;
+static bool recording;
+static uint16_t ticks;
+static uint16_t saving; // the bytes left to save, the header last
+
+/**
+ * Saves a byte of the record, from the end backwards, so that the version
+ * is written last and a save interrupted by a power loss leaves no record.
+ */
+static void save_byte() {
+    --saving;
+    const uint8_t* from = reinterpret_cast<const uint8_t*>(&current);
+    uint8_t* to = reinterpret_cast<uint8_t*>(&saved_record);
+    eeprom_update_byte(to + saving, from[saving]);
+}
+
+static uint8_t dump_bytes(uint8_t crc, uint16_t offset, uint16_t size) {
+    const uint8_t* from = reinterpret_cast<const uint8_t*>(&saved_record);
+    for (uint16_t i = offset; i < offset + size; ++i) {
+        const uint8_t unit = eeprom_read_byte(from + i);
+        link::write(unit);
+        crc = protocol::crc8(crc, unit);
+    }
+    return crc;
+}
+
+namespace recorder {
+
+    void start(uint8_t start_speed) {
+        // the previous game is saved before the buffer is reused
+        while (saving) {
+            eeprom_busy_wait();
+            save_byte();
+        }
+        current.head.version = FORMAT_VERSION;
+        current.head.start_speed = start_speed;
+        current.head.track = vm::track_id();
+        current.head.score = 0;
+        current.head.steers = 0;
+        current.head.flags = 0;
+        ticks = 0;
+        recording = true;
+        // an interrupted game leaves no record
+        eeprom_update_byte(&saved_record.head.version, 0xFF);
+    }
+
+    void tick() {
+        if (!recording) return;
+        if (ticks == 0xFFFF) {
+            current.head.flags |= flags::truncated;
+            recording = false;
+            return;
+        }
+        ++ticks;
+    }
+
+    void steer(int16_t slack) {
+        if (!recording) return;
+        if (current.head.steers == MAX_STEERS) {
+            current.head.flags |= flags::truncated;
+            recording = false;
+            return;
+        }
+        current.steers[current.head.steers++] = { ticks, slack };
+        ticks = 0;
+    }
+
+    void stop(uint16_t score) {
+        current.head.score = score;
+        recording = false;
+        saving = sizeof(header) + current.head.steers * sizeof(entry);
+    }
+
+    void run() {
+        if (saving && eeprom_is_ready()) save_byte();
+    }
+
+    void dump() {
+        const uint8_t version = eeprom_read_byte(&saved_record.head.version);
+        uint8_t steers = eeprom_read_byte(&saved_record.head.steers);
+        if (version != FORMAT_VERSION) steers = 0;
+        if (steers > MAX_STEERS) steers = MAX_STEERS;
+
+        link::init();
+        uint8_t crc = dump_bytes(0, 0, sizeof(header));
+        crc = dump_bytes(crc, sizeof(header), steers * sizeof(entry));
+        link::write(crc);
+    }
+}
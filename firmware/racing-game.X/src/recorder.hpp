@@ -0,0 +1,123 @@
+/* 
+ * File:   recorder.hpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef RECORDER_HPP_DEFINED
+#define	RECORDER_HPP_DEFINED
+
+#include <stdint.h>
+
+/**
+ * The recorder of the games: it saves the steers of the last game to the
+ * EEPROM, stamped with the VM ticks, so that a host replays the game
+ * on the VM and reproduces each segment shown (@see tools/replay.cpp).
+ * The VM is deterministic: its state only depends on the start speed
+ * and on the sequence of ticks and steers.
+ * Holding the key at power-on dumps the record over the link.
+ */
+namespace recorder {
+
+    /**
+     * The version of the record format, never 0xFF (erased EEPROM).
+     */
+    constexpr uint8_t FORMAT_VERSION = 1;
+
+    /**
+     * The number of steers recorded: a game with more is truncated.
+     */
+    constexpr uint8_t MAX_STEERS = 62;
+
+    namespace flags {
+        constexpr uint8_t truncated = 0x01; // the game went on after the last steer recorded
+    }
+
+    struct header {
+        uint8_t version;     // FORMAT_VERSION, written last
+        uint8_t start_speed; // @see vm::reset()
+        uint16_t track;      // @see vm::track_id()
+        uint16_t score;      // the final score, to check the replay
+        uint8_t steers;      // the number of steers recorded
+        uint8_t flags;
+    };
+
+    /**
+     * A steer of the player.
+     */
+    struct entry {
+        uint16_t ticks; // the VM ticks since the previous steer or the start
+        int16_t slack;  // the RTC counts from the key press to the deadline
+                        // of the move, negative if judged on the next move
+    };
+
+    /**
+     * The record of a game, as saved to the EEPROM.
+     * The dump sends the header, the steers recorded and a CRC-8
+     * (polynomial 0x07) of them, all fields in little-endian order.
+     */
+    struct record {
+        header head;
+        entry steers[MAX_STEERS];
+    };
+
+    static_assert(sizeof(record) <= 256, "the record must fit in the EEPROM");
+
+    /**
+     * Starts to record a game.
+     * Finishes saving the previous one first.
+     * @param start_speed The start speed of the VM.
+     */
+    void start(uint8_t start_speed);
+
+    /**
+     * Records a tick of the VM.
+     */
+    void tick();
+
+    /**
+     * Records a steer of the player, before the VM reacts to it.
+     * @param slack The RTC counts from the key press to the deadline
+     *              of the move.
+     */
+    void steer(int16_t slack);
+
+    /**
+     * Stops recording and starts saving the game.
+     * @param score The final score.
+     */
+    void stop(uint16_t score);
+
+    /**
+     * Saves the record, one byte at a time as the EEPROM gets ready.
+     * Call this function in the main loop.
+     */
+    void run();
+
+    /**
+     * Sends the record saved over the link (@see link::write()).
+     */
+    void dump();
+}
+
+#endif	/* RECORDER_HPP_DEFINED */
@@ -0,0 +1,452 @@
+/* 
+ * File:   track.hpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TRACK_HPP_DEFINED
+#define	TRACK_HPP_DEFINED
+
+#include <stdint.h>
+
+/*
+ * The compiler of the tracks into the bytecode of the game VM.
+ * It runs at compile time, so a track that does not verify does not build.
+ *
+ * A track is a text of tokens separated by spaces:
+ *   a .. g          the car drives on the segment, and crashes if the player steers;
+ *   a>label .. g>label
+ *                   the car drives on the segment, and turns to label if the player steers;
+ *   @label          the track continues at label;
+ *   #n              the next segments are on module n;
+ *   label:          names the next instruction.
+ * The game starts at the first instruction, on module 0, and the first
+ * instruction cannot be a turn target.
+ * Module 0 is the display of the game, the next ones are the modules
+ * of the chain, side by side: the right vertices of a module are
+ * the left vertices of the next one.
+ */
+namespace track {
+
+    enum opcode: uint8_t {
+        op_jump = 0,  // PC = next_pc(), fetch, exec tick
+
+        op_a,     // turn on segment a, increment PC, steer (vm_next != 0), pause
+        op_b,     // turn on segment b, increment PC, steer (vm_next != 0), pause
+        op_c,     // turn on segment c, increment PC, steer (vm_next != 0), pause
+        op_d,     // turn on segment d, increment PC, steer (vm_next != 0), pause
+        op_e,     // turn on segment e, increment PC, steer (vm_next != 0), pause
+        op_f,     // turn on segment f, increment PC, steer (vm_next != 0), pause
+        op_g,     // turn on segment g, increment PC, steer (vm_next != 0), pause
+
+        op_module, // module = next_pc(), increment PC, fetch, exec tick
+
+        // on failed steer: decrement cars, reset speed, PC = 0, module = 0, fetch, stop VM
+        // on successful steer: increment score, recompute speed, PC = next_pc(), fetch, exec_tick
+    };
+
+    /**
+     * The instructions are 16-bit: a 4-bit opcode and a 12-bit PC.
+     */
+    constexpr uint8_t OPCODE_SHIFT = 12;
+    constexpr uint16_t PC_MASK = (1 << OPCODE_SHIFT) - 1;
+    constexpr uint16_t MAX_SIZE = PC_MASK + 1;
+
+    constexpr uint16_t instruction(const opcode on_tick, const uint16_t next_pc) {
+        return ((uint16_t)on_tick << OPCODE_SHIFT) | next_pc;
+    }
+
+    constexpr opcode get_opcode(uint16_t instruction) {
+        return static_cast<opcode>(instruction >> OPCODE_SHIFT);
+    }
+
+    constexpr uint16_t get_next_pc(uint16_t instruction) {
+        return instruction & PC_MASK;
+    }
+
+    enum class error: uint8_t {
+        none = 0,
+        syntax,          // a token is not a segment, a jump, a module or a label
+        duplicate_label, // a label names two instructions
+        unknown_label,   // a turn or a jump to a missing label
+        turn_to_start,   // the first instruction is a turn target (PC 0 means crash)
+        too_long,        // more than MAX_SIZE instructions
+        off_end,         // the last segment continues past the end of the track
+        unreachable,     // the car can never drive on an instruction
+        no_segment,      // a loop of jumps never shows a segment
+        no_exit,         // the car drives a loop without turns forever
+        not_adjacent,    // consecutive segments do not touch
+        wrong_way,       // the car reaches a segment from both ends, or on two modules
+    };
+
+    /**
+     * A compiled track.
+     * @param N The number of instructions.
+     */
+    template <uint16_t N>
+    struct program {
+        uint16_t code[N] {};
+        error status = error::none;
+        uint16_t where = 0; // the PC of the first instruction in error
+    };
+
+    namespace compiler {
+
+        constexpr uint16_t NOT_FOUND = 0xFFFF;
+
+        constexpr bool is_space(char c) {
+            return c == ' ' || c == '\t' || c == '\n';
+        }
+
+        constexpr uint16_t skip_spaces(const char* text, uint16_t pos) {
+            while (is_space(text[pos])) ++pos;
+            return pos;
+        }
+
+        constexpr uint16_t token_end(const char* text, uint16_t pos) {
+            while (text[pos] && !is_space(text[pos])) ++pos;
+            return pos;
+        }
+
+        constexpr bool is_label(const char* text, uint16_t begin, uint16_t end) {
+            return end - begin > 1 && text[end - 1] == ':';
+        }
+
+        constexpr bool same_name(const char* text, uint16_t a, uint16_t b, uint16_t length) {
+            for (uint16_t i = 0; i < length; ++i) {
+                if (text[a + i] != text[b + i]) return false;
+            }
+            return true;
+        }
+
+        /**
+         * @return The number of instructions of the track.
+         */
+        constexpr uint16_t size(const char* text) {
+            uint16_t count = 0;
+            for (uint16_t pos = skip_spaces(text, 0); text[pos]; pos = skip_spaces(text, pos)) {
+                const uint16_t end = token_end(text, pos);
+                if (!is_label(text, pos, end)) ++count;
+                pos = end;
+            }
+            return count;
+        }
+
+        /**
+         * @return The PC named by a label, or NOT_FOUND.
+         */
+        constexpr uint16_t find_label(const char* text, uint16_t name, uint16_t length) {
+            uint16_t pc = 0;
+            for (uint16_t pos = skip_spaces(text, 0); text[pos]; pos = skip_spaces(text, pos)) {
+                const uint16_t end = token_end(text, pos);
+                if (!is_label(text, pos, end)) {
+                    ++pc;
+                } else if (end - pos - 1 == length && same_name(text, pos, name, length)) {
+                    return pc;
+                }
+                pos = end;
+            }
+            return NOT_FOUND;
+        }
+
+        constexpr uint8_t count_labels(const char* text, uint16_t name, uint16_t length) {
+            uint8_t count = 0;
+            for (uint16_t pos = skip_spaces(text, 0); text[pos]; pos = skip_spaces(text, pos)) {
+                const uint16_t end = token_end(text, pos);
+                if (is_label(text, pos, end) && end - pos - 1 == length && same_name(text, pos, name, length)) {
+                    ++count;
+                }
+                pos = end;
+            }
+            return count;
+        }
+
+        /*
+         * The segments meet at six vertices:
+         *
+         *   0 -a- 1
+         *   f     b
+         *   2 -g- 3
+         *   e     c
+         *   4 -d- 5
+         */
+        constexpr uint16_t NO_VERTEX = 0xFFFF;
+
+        constexpr uint8_t vertex(opcode op, uint8_t end) {
+            constexpr uint8_t ends[7][2] = {
+                {0, 1}, // a
+                {1, 3}, // b
+                {3, 5}, // c
+                {4, 5}, // d
+                {2, 4}, // e
+                {0, 2}, // f
+                {2, 3}, // g
+            };
+            return ends[op - op_a][end];
+        }
+
+        /**
+         * @return The vertex of a segment end across the modules:
+         *         the right vertices of a module are the left ones of the next.
+         */
+        constexpr uint16_t vertex(uint8_t module, opcode op, uint8_t end) {
+            const uint8_t v = vertex(op, end);
+            return v & 1 ? (module + 1) * 6 + v - 1 : module * 6 + v;
+        }
+
+        constexpr uint16_t shared_vertex(uint8_t module_a, opcode a, uint8_t module_b, opcode b) {
+            for (uint8_t i = 0; i < 2; ++i) {
+                for (uint8_t j = 0; j < 2; ++j) {
+                    if (vertex(module_a, a, i) == vertex(module_b, b, j)) return vertex(module_a, a, i);
+                }
+            }
+            return NO_VERTEX;
+        }
+
+        constexpr uint16_t other_vertex(uint8_t module, opcode op, uint16_t v) {
+            return vertex(module, op, 0) == v ? vertex(module, op, 1) : vertex(module, op, 0);
+        }
+
+        constexpr bool is_segment(uint16_t instruction) {
+            return get_opcode(instruction) >= op_a && get_opcode(instruction) <= op_g;
+        }
+
+        template <uint16_t N>
+        constexpr program<N> fail(program<N> p, error status, uint16_t where) {
+            p.status = status;
+            p.where = where;
+            return p;
+        }
+
+        /**
+         * Follows the jumps and the module selections from a PC
+         * to the instruction that shows a segment.
+         * @param module The module at the PC, set to the one of the segment.
+         * @return Its PC, or NOT_FOUND if the jumps loop.
+         */
+        template <uint16_t N>
+        constexpr uint16_t resolve(const program<N>& p, uint16_t pc, uint8_t& module) {
+            for (uint16_t steps = 0; steps <= N; ++steps) {
+                const uint16_t instruction = p.code[pc];
+                if (is_segment(instruction)) return pc;
+                if (get_opcode(instruction) == op_module) {
+                    module = get_next_pc(instruction);
+                    ++pc;
+                } else {
+                    pc = get_next_pc(instruction);
+                }
+            }
+            return NOT_FOUND;
+        }
+
+        /**
+         * Checks that every instruction is reachable from the start,
+         * and that no segment continues past the end.
+         */
+        template <uint16_t N>
+        constexpr program<N> verify_reachable(const program<N>& p) {
+            bool seen[N] {};
+            uint16_t pending[N] {};
+            uint16_t count = 0;
+            seen[0] = true;
+            pending[count++] = 0;
+            while (count) {
+                const uint16_t pc = pending[--count];
+                const uint16_t instruction = p.code[pc];
+                uint16_t next[2] = { get_next_pc(instruction), NOT_FOUND };
+                if (get_opcode(instruction) != op_jump) {
+                    if (pc + 1 >= N) return fail(p, error::off_end, pc);
+                    next[0] = pc + 1;
+                    if (is_segment(instruction) && get_next_pc(instruction)) next[1] = get_next_pc(instruction);
+                }
+                for (uint16_t target : next) {
+                    if (target == NOT_FOUND || seen[target]) continue;
+                    seen[target] = true;
+                    pending[count++] = target;
+                }
+            }
+            for (uint16_t pc = 0; pc < N; ++pc) {
+                if (!seen[pc]) return fail(p, error::unreachable, pc);
+            }
+            return p;
+        }
+
+        /**
+         * Checks that the car may leave every loop the track runs
+         * when the player does not steer, and that every loop shows segments.
+         */
+        template <uint16_t N>
+        constexpr program<N> verify_loops(const program<N>& p) {
+            for (uint16_t start = 0; start < N; ++start) {
+                // after N instructions without steering, the car is in a loop
+                uint16_t pc = start;
+                for (uint16_t steps = 0; steps < N; ++steps) {
+                    const uint16_t instruction = p.code[pc];
+                    pc = get_opcode(instruction) == op_jump ? get_next_pc(instruction) : pc + 1;
+                }
+                const uint16_t loop = pc;
+                bool has_segment = false;
+                bool has_turn = false;
+                do {
+                    const uint16_t instruction = p.code[pc];
+                    if (get_opcode(instruction) == op_jump) {
+                        pc = get_next_pc(instruction);
+                    } else {
+                        if (is_segment(instruction)) {
+                            has_segment = true;
+                            if (get_next_pc(instruction)) has_turn = true;
+                        }
+                        pc = pc + 1;
+                    }
+                } while (pc != loop);
+                if (!has_segment) return fail(p, error::no_segment, loop);
+                if (!has_turn) return fail(p, error::no_exit, loop);
+            }
+            return p;
+        }
+
+        /**
+         * Checks that the car drives from each segment to a touching one,
+         * always at the end opposite to the one it entered from,
+         * and that each segment is always on the same module.
+         */
+        template <uint16_t N>
+        constexpr program<N> verify_path(const program<N>& p) {
+            uint16_t entry[N] {};
+            uint8_t modules[N] {};
+            for (uint16_t pc = 0; pc < N; ++pc) entry[pc] = NO_VERTEX;
+            uint16_t pending[N] {};
+            uint16_t count = 0;
+
+            // the car enters the first segment from the end opposite to the next one
+            uint8_t first_module = 0;
+            const uint16_t first = resolve(p, 0, first_module);
+            const opcode first_op = get_opcode(p.code[first]);
+            uint8_t next_module = first_module;
+            const uint16_t second = resolve(p, first + 1, next_module);
+            const uint16_t first_exit = shared_vertex(first_module, first_op, next_module, get_opcode(p.code[second]));
+            if (first_exit == NO_VERTEX) return fail(p, error::not_adjacent, first);
+            entry[first] = other_vertex(first_module, first_op, first_exit);
+            modules[first] = first_module;
+            pending[count++] = first;
+
+            while (count) {
+                const uint16_t pc = pending[--count];
+                const opcode op = get_opcode(p.code[pc]);
+                const uint8_t module = modules[pc];
+                const uint16_t exit = other_vertex(module, op, entry[pc]);
+                const uint16_t turn = get_next_pc(p.code[pc]);
+                for (uint8_t branch = 0; branch < 2; ++branch) {
+                    if (branch && !turn) break;
+                    uint8_t target_module = module;
+                    const uint16_t target = resolve(p, branch ? turn : pc + 1, target_module);
+                    const opcode target_op = get_opcode(p.code[target]);
+                    if (vertex(target_module, target_op, 0) != exit && vertex(target_module, target_op, 1) != exit) {
+                        return fail(p, error::not_adjacent, pc);
+                    }
+                    if (entry[target] == NO_VERTEX) {
+                        entry[target] = exit;
+                        modules[target] = target_module;
+                        pending[count++] = target;
+                    } else if (entry[target] != exit || modules[target] != target_module) {
+                        return fail(p, error::wrong_way, target);
+                    }
+                }
+            }
+            return p;
+        }
+    }
+
+    /**
+     * Gets the number of instructions of a track, to size its program.
+     * @param text The track.
+     * @return The number of instructions.
+     */
+    constexpr uint16_t size(const char* text) {
+        return compiler::size(text);
+    }
+
+    /**
+     * Compiles and verifies a track.
+     * @param N The number of instructions (@see size()).
+     * @param text The track.
+     * @return The program, whose status is error::none if the track is valid.
+     */
+    template <uint16_t N>
+    constexpr program<N> compile(const char* text) {
+        using namespace compiler;
+
+        program<N> p {};
+        if (N > MAX_SIZE) return fail(p, error::too_long, MAX_SIZE);
+
+        uint16_t pc = 0;
+        for (uint16_t pos = skip_spaces(text, 0); text[pos]; pos = skip_spaces(text, pos)) {
+            const uint16_t end = token_end(text, pos);
+            const uint16_t begin = pos;
+            pos = end;
+
+            if (is_label(text, begin, end)) {
+                if (count_labels(text, begin, end - begin - 1) > 1) return fail(p, error::duplicate_label, pc);
+                continue;
+            }
+
+            if (text[begin] == '#') {
+                uint16_t module = 0;
+                if (end - begin < 2) return fail(p, error::syntax, pc);
+                for (uint16_t i = begin + 1; i < end; ++i) {
+                    if (text[i] < '0' || text[i] > '9') return fail(p, error::syntax, pc);
+                    module = module * 10 + (text[i] - '0');
+                    if (module > 0xFF) return fail(p, error::syntax, pc);
+                }
+                p.code[pc++] = instruction(op_module, module);
+                continue;
+            }
+
+            if (text[begin] == '@') {
+                const uint16_t target = find_label(text, begin + 1, end - begin - 1);
+                if (target == NOT_FOUND) return fail(p, error::unknown_label, pc);
+                p.code[pc++] = instruction(op_jump, target);
+                continue;
+            }
+
+            if (text[begin] < 'a' || text[begin] > 'g') return fail(p, error::syntax, pc);
+            const opcode op = static_cast<opcode>(op_a + (text[begin] - 'a'));
+            uint16_t target = 0;
+            if (end - begin > 1) {
+                if (text[begin + 1] != '>' || end - begin < 3) return fail(p, error::syntax, pc);
+                target = find_label(text, begin + 2, end - begin - 2);
+                if (target == NOT_FOUND) return fail(p, error::unknown_label, pc);
+                if (target == 0) return fail(p, error::turn_to_start, pc);
+            }
+            p.code[pc++] = instruction(op, target);
+        }
+
+        p = verify_reachable(p);
+        if (p.status != error::none) return p;
+        p = verify_loops(p);
+        if (p.status != error::none) return p;
+        return verify_path(p);
+    }
+}
+
+#endif	/* TRACK_HPP_DEFINED */
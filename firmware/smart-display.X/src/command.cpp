@@ -0,0 +1,412 @@
+/* 
+ * File:   command.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+
+#include "command.hpp"
+#include "effect.hpp"
+#include "protocol.hpp"
+#include "serial.hpp"
+#include "telemetry.hpp"
+#include "timer.hpp"
+
+static_assert(command::code::sync < effect::attribute::steady,
+    "a command code must not be read as an attribute code");
+
+static volatile bool changed;
+static volatile uint8_t rx_code;
+static volatile uint8_t rx_attr;
+static volatile bool brightness_changed;
+static volatile uint8_t brightness;
+static volatile uint8_t store_settings;
+
+static struct {
+    bool passed;     // the slot of this module was already written or skipped
+    bool corrupted;  // the message had link errors
+    uint8_t op;      // the command being decoded, 0 if none
+    uint8_t argc;    // the number of operands received
+    uint8_t args[2];
+    uint8_t raw;     // the number of units to forward unchanged
+    uint8_t attr;    // the attribute of the characters that follow
+    bool marquee;    // character codes are shifted along the chain, kept across messages
+
+    uint8_t rx_crc;    // CRC of the units received since the last commit
+    uint8_t tx_crc;    // CRC of the units forwarded since the last commit
+    uint8_t check_crc; // CRC of the units received before the CHECK code
+
+    bool staged;       // a character was written to the slot of this module
+    uint8_t staged_code;
+    uint8_t staged_attr;
+    bool staged_brightness;
+    uint8_t staged_level;
+    uint8_t staged_store;
+    bool staged_marquee;  // a MARQUEE was received, its mode applies to the rest of the message
+    bool staged_marquee_on;
+
+    inline uint8_t operands() {
+        switch (op) {
+            case command::code::fill:
+            case command::code::write:
+            case command::code::segs:
+                return 2;
+            default:
+                return 1;
+        }
+    }
+
+    inline bool shifting() {
+        return staged_marquee ? staged_marquee_on : marquee;
+    }
+
+    inline void emit(uint8_t unit) {
+        tx_crc = protocol::crc8(tx_crc, unit);
+        serial::forward(unit);
+    }
+
+    inline void latch(uint8_t c) {
+        staged_code = c;
+        staged_attr = attr;
+        staged = true;
+    }
+
+    void commit() {
+        if (staged) {
+            rx_code = staged_code;
+            rx_attr = staged_attr;
+            changed = true;
+            staged = false;
+        }
+        if (staged_brightness) {
+            brightness = staged_level;
+            brightness_changed = true;
+            staged_brightness = false;
+        }
+        if (staged_store) {
+            store_settings |= staged_store;
+            staged_store = 0;
+        }
+        if (staged_marquee) {
+            marquee = staged_marquee_on;
+            staged_marquee = false;
+        }
+    }
+
+    void drop() {
+        if (staged || staged_brightness || staged_store || staged_marquee) serial::count_dropped();
+        staged = false;
+        staged_brightness = false;
+        staged_store = 0;
+        staged_marquee = false;
+    }
+
+    void emit_check(bool valid) {
+        serial::forward(command::code::check);
+        serial::forward(valid ? tx_crc : ~tx_crc);
+        rx_crc = 0;
+        tx_crc = 0;
+    }
+
+    void glyph(uint8_t c) {
+        if (passed) {
+            emit(c);
+        } else {
+            latch(c);
+            passed = true;
+        }
+    }
+
+    void shift(uint8_t c) {
+        // the character shifted out must not be decoded as a command
+        uint8_t out = staged ? staged_code : rx_code;
+        if (command::is_command(out) || effect::is_attribute(out)) out = ' ';
+        emit(out);
+        latch(c);
+    }
+
+    void skip(uint8_t n) {
+        if (!n) return;
+        if (!passed) {
+            passed = true;
+            if (!--n) return;
+        }
+        emit(command::code::skip);
+        emit(n);
+    }
+
+    void fill(uint8_t n, uint8_t c) {
+        if (!n) return;
+        if (!passed) {
+            latch(c);
+            passed = true;
+            --n;
+        }
+        if (n == 1 && !command::is_command(c) && !effect::is_attribute(c)) {
+            emit(c);
+        } else if (n) {
+            emit(command::code::fill);
+            emit(n);
+            emit(c);
+        }
+    }
+
+    void write(uint8_t offset, uint8_t c) {
+        if (offset) {
+            emit(command::code::write);
+            emit(offset - 1);
+            emit(c);
+        } else {
+            latch(c);
+        }
+    }
+
+    void segs(uint8_t offset, uint8_t map) {
+        if (offset) {
+            emit(command::code::segs);
+            emit(offset - 1);
+            emit(map);
+        } else {
+            staged_code = map;
+            staged_attr = effect::attribute::raw;
+            staged = true;
+        }
+    }
+
+    void bright(uint8_t level) {
+        staged_level = level;
+        staged_brightness = true;
+        emit(command::code::bright);
+        emit(level);
+    }
+
+    void store(uint8_t flags) {
+        staged_store |= flags;
+        emit(command::code::store);
+        emit(flags);
+    }
+
+    void start_marquee(uint8_t m) {
+        staged_marquee_on = m;
+        staged_marquee = true;
+        emit(command::code::marquee);
+        emit(m);
+    }
+
+    void sync(uint8_t hops) {
+        // each module receives the operand two units after the previous one
+        timer::sync((uint32_t)hops * 2 * serial::unit_time_us());
+        emit(command::code::sync);
+        emit(hops + 1);
+    }
+
+    void check(uint8_t crc) {
+        const bool valid = !corrupted && crc == check_crc;
+        if (valid) {
+            commit();
+        } else {
+            drop();
+        }
+        emit_check(valid);
+    }
+
+    void query(uint8_t kind) {
+        emit(command::code::report);
+        if (kind == command::report::errors) {
+            const serial::counters counters = serial::get_counters();
+            emit(5);
+            emit(kind);
+            emit(counters.rx_errors);
+            emit(counters.rx_errors >> 8);
+            emit(counters.dropped);
+            emit(counters.dropped >> 8);
+        } else if (kind == command::report::telemetry && telemetry::ENABLED) {
+            const telemetry::report measures = telemetry::get_report();
+            emit(22);
+            emit(kind);
+            for (const telemetry::cycles& handler : measures.handlers) {
+                emit(handler.max);
+                emit(handler.max >> 8);
+                emit(handler.avg);
+                emit(handler.avg >> 8);
+            }
+            emit(measures.isr_free_percent);
+            emit(measures.mux_min);
+            emit(measures.mux_min >> 8);
+            emit(measures.mux_max);
+            emit(measures.mux_max >> 8);
+        } else {
+            emit(1);
+            emit(kind);
+        }
+        emit(command::code::query);
+        emit(kind);
+    }
+
+    void exec() {
+        switch (op) {
+            case command::code::skip:
+                skip(args[0]);
+                break;
+            case command::code::fill:
+                fill(args[0], args[1]);
+                break;
+            case command::code::write:
+                write(args[0], args[1]);
+                break;
+            case command::code::segs:
+                segs(args[0], args[1]);
+                break;
+            case command::code::bright:
+                bright(args[0]);
+                break;
+            case command::code::check:
+                check(args[0]);
+                break;
+            case command::code::query:
+                query(args[0]);
+                break;
+            case command::code::marquee:
+                start_marquee(args[0]);
+                break;
+            case command::code::store:
+                store(args[0]);
+                break;
+            case command::code::sync:
+                sync(args[0]);
+                break;
+            case command::code::report:
+                emit(command::code::report);
+                emit(args[0]);
+                raw = args[0];
+                break;
+        }
+        op = 0;
+    }
+
+    void receive(uint8_t unit) {
+        const uint8_t crc = rx_crc;
+        rx_crc = protocol::crc8(crc, unit);
+
+        if (raw) {
+            --raw;
+            emit(unit);
+        } else if (op) {
+            args[argc++] = unit;
+            if (argc == operands()) exec();
+        } else if (command::is_command(unit)) {
+            op = unit;
+            argc = 0;
+            check_crc = crc;
+        } else if (effect::is_attribute(unit)) {
+            attr = unit;
+            emit(unit);
+        } else if (shifting()) {
+            shift(unit);
+        } else {
+            glyph(unit);
+        }
+    }
+
+    void end() {
+        // a message truncated in the middle of a command lost some units
+        if (corrupted || op || raw) {
+            drop();
+        } else {
+            commit();
+        }
+        reset();
+    }
+
+    void abort() {
+        if (corrupted) return;
+        corrupted = true;
+        drop();
+        emit_check(false);
+    }
+
+    void reset() {
+        passed = false;
+        corrupted = false;
+        op = 0;
+        raw = 0;
+        attr = 0;
+        rx_crc = 0;
+        tx_crc = 0;
+    }
+
+} state;
+
+namespace command {
+
+    void end_message() {
+        state.end();
+    }
+
+    void abort_message() {
+        state.abort();
+    }
+
+    void receive(uint8_t unit) {
+        state.receive(unit);
+    }
+
+    bool has_data() {
+        return changed;
+    }
+
+    uint8_t get_data() {
+        changed = false;
+        return rx_code;
+    }
+
+    uint8_t get_attribute() {
+        return rx_attr;
+    }
+
+    bool has_brightness() {
+        return brightness_changed;
+    }
+
+    uint8_t get_brightness() {
+        brightness_changed = false;
+        return brightness;
+    }
+
+    bool has_store() {
+        return store_settings;
+    }
+
+    uint8_t get_store() {
+        // the flags are set from the IRQ handler
+        cli();
+        const uint8_t flags = store_settings;
+        store_settings = 0;
+        sei();
+        return flags;
+    }
+
+}
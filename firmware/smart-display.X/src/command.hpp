@@ -0,0 +1,152 @@
+/* 
+ * File:   command.hpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef COMMAND_HPP_INCLUDED
+#define COMMAND_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "protocol.hpp"
+
+/**
+ * The command set of the store-and-forward mode.
+ * Each module owns the first slot of the messages it receives.
+ * Character codes write the next slot. Commands are 7-bit control codes
+ * followed by their operands. Each module applies the part of a command
+ * that concerns its own slot, then forwards the rest of it, rewritten
+ * for the next module of the chain.
+ * Writes are committed at the end of the message, or by a CHECK command
+ * when the CRC-8 (polynomial 0x07, initial value 0) of the units received
+ * since the previous commit matches. Otherwise, they are dropped and
+ * the last good character stays displayed.
+ * Attribute codes (@see effect::attribute) set the effect of the characters
+ * that follow them in the message.
+ * In marquee mode, each character code is shifted in as it arrives:
+ * the module forwards its character to the next one and stages the new one,
+ * so text scrolls along the chain one unit at a time. MARQUEE is staged too:
+ * it applies to the characters that follow it in the message, and the mode
+ * is kept only once the message is committed.
+ * SYN aligns the timers that run the effects: the host sends SYN 0 and
+ * each module advances its timer by the forwarding delay of the modules
+ * before it, so the timers of the whole chain restart together.
+ * STORE saves settings in the EEPROM of each module once committed:
+ * the glyph shown at boot (splash) and whether the last glyph shown
+ * is restored at boot instead.
+ * SEGS writes raw segments instead of a character, for hosts that draw
+ * on the chain, such as the racing game (@see display::segment).
+ */
+namespace command {
+
+    namespace code = protocol::code;
+
+    namespace store {
+        constexpr uint8_t splash      = 0x01; // the glyph shown becomes the splash glyph
+        constexpr uint8_t persist     = 0x02; // the last glyph is shown at boot
+        constexpr uint8_t no_persist  = 0x04; // the splash glyph is shown at boot
+    }
+
+    namespace report {
+        constexpr uint8_t errors    = 0x01; // rx_errors, dropped (16-bit, little endian)
+        constexpr uint8_t telemetry = 0x02; // @see telemetry::report (diagnostic builds only)
+    }
+
+    /**
+     * Checks whether a message unit is a command code.
+     * Any other message unit is a character code.
+     * @param unit The message unit to check.
+     * @return true if the message unit is a command code, false otherwise.
+     */
+    inline bool is_command(uint8_t unit) {
+        return code::skip <= unit && unit <= code::sync;
+    }
+
+    /**
+     * Marks the end of a message.
+     * The next message starts again from the slot of this module.
+     * Called from the protocol timeout IRQ handler.
+     */
+    void end_message();
+
+    /**
+     * Drops the writes of the current message because of a link error.
+     * The next modules are notified with a failed CHECK.
+     * Called from the RX IRQ handler.
+     */
+    void abort_message();
+
+    /**
+     * Decodes a message unit and forwards what concerns the other modules.
+     * Called from the RX IRQ handler.
+     * @param unit The received message unit.
+     */
+    void receive(uint8_t unit);
+
+    /**
+     * Checks whether a character to display was received.
+     * @return true if a character code was received, false otherwise.
+     */
+    bool has_data();
+
+    /**
+     * Gets the last character code written to this module's slot.
+     * @return The last received character code.
+     */
+    uint8_t get_data();
+
+    /**
+     * Gets the attribute code of the last character code.
+     * @return The attribute code, or 0 if none was received,
+     *         or effect::attribute::raw if the code is a segment map.
+     */
+    uint8_t get_attribute();
+
+    /**
+     * Checks whether a brightness level was received.
+     * @return true if a brightness level was received, false otherwise.
+     */
+    bool has_brightness();
+
+    /**
+     * Gets the last received brightness level.
+     * @return The last received brightness level.
+     */
+    uint8_t get_brightness();
+
+    /**
+     * Checks whether settings must be stored.
+     * @return true if a STORE command was committed, false otherwise.
+     */
+    bool has_store();
+
+    /**
+     * Gets the settings to store (@see command::store), since the last call.
+     * @return The settings to store.
+     */
+    uint8_t get_store();
+
+}
+
+#endif /* COMMAND_HPP_INCLUDED */
@@ -0,0 +1,72 @@
+/* 
+ * File:   config.hpp
+ * Author: Gabriele Falcioni
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CONFIG_HPP_INCLUDED
+#define CONFIG_HPP_INCLUDED
+
+#include <stdint.h>
+
+#include "pins.hpp"
+
+/**
+ * The configuration of the core drivers for the smart display module.
+ * Each application provides its own, the core drivers are built with it.
+ */
+namespace config {
+
+    /**
+     * The pins of the segments, in the order of the segment maps
+     * (a, b, c, d, e, f, g, dp).
+     */
+    constexpr pins::pin SEGMENT_PINS[] = {
+        {pins::port::b, 5}, // a
+        {pins::port::b, 4}, // b
+        {pins::port::b, 2}, // c
+        {pins::port::b, 1}, // d
+        {pins::port::b, 0}, // e
+        {pins::port::a, 7}, // f
+        {pins::port::a, 6}, // g
+        {pins::port::b, 3}, // dp
+    };
+
+    /**
+     * The interval to keep a segment turned on, in milliseconds.
+     */
+    constexpr uint16_t MUX_INTERVAL_MS = 1;
+
+    /**
+     * The frequency of the timer ticks.
+     */
+    constexpr uint8_t TICKS_PER_SEC = 50;
+
+    /**
+     * Diagnostic builds measure the IRQ handlers (@see telemetry.hpp).
+     */
+    constexpr bool TELEMETRY = false;
+
+}
+
+#endif /* CONFIG_HPP_INCLUDED */
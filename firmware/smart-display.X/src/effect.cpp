@@ -0,0 +1,98 @@
+/* 
+ * File:   effect.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#include "display.hpp"
+#include "effect.hpp"
+#include "timer.hpp"
+
+/**
+ * The period of the effects at the fastest rate, in ticks.
+ * Periods must divide the range of the 8-bit tick counter:
+ * run() assumes that 256 ticks are 16 base periods.
+ */
+constexpr uint8_t BASE_PERIOD_TICKS = 16;
+
+static uint8_t segs;
+static uint8_t attr = effect::attribute::steady;
+static uint8_t level = display::MAX_BRIGHTNESS;
+
+static bool shown_lit;
+static uint8_t shown_level = display::MAX_BRIGHTNESS;
+
+inline void render(bool lit, uint8_t new_level) {
+    if (lit != shown_lit) {
+        display::show_segments(lit ? segs : 0);
+        shown_lit = lit;
+    }
+    if (new_level != shown_level) {
+        display::set_brightness(new_level);
+        shown_level = new_level;
+    }
+}
+
+namespace effect {
+
+    void show(char code, uint8_t attribute) {
+        segs = attribute == attribute::raw ? (uint8_t)code : display::char_to_segs(code);
+        attr = is_attribute(attribute) ? attribute : attribute::steady;
+        shown_lit = false; // forces the new segments to be shown
+        render(true, level);
+        run();
+    }
+
+    void set_brightness(uint8_t new_level) {
+        level = new_level < display::MAX_BRIGHTNESS ? new_level : display::MAX_BRIGHTNESS;
+        render(shown_lit, level);
+        run();
+    }
+
+    void run() {
+        const uint8_t effect = attr & attribute::effect_mask;
+        if (!effect) return;
+
+        // the phase of the effect, scaled to 0..255 whatever its period
+        const uint8_t rate = (attr & attribute::rate_mask) >> attribute::rate_shift;
+        const uint8_t period = BASE_PERIOD_TICKS << rate;
+        const uint8_t phase = (timer::ticks() & (period - 1)) << (4 - rate);
+
+        switch (effect) {
+            case attribute::blink & attribute::effect_mask:
+                render(phase < 128, level);
+                break;
+            case attribute::pulse & attribute::effect_mask:
+                render(phase < 32, level);
+                break;
+            case attribute::fade & attribute::effect_mask: {
+                const uint8_t ramp = phase < 128 ? phase << 1 : (255 - phase) << 1;
+                render(true, (uint16_t)ramp * (level + 1) >> 8);
+                break;
+            }
+        }
+    }
+
+}
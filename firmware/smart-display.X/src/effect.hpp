@@ -0,0 +1,91 @@
+/* 
+ * File:   effect.hpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef EFFECT_HPP_INCLUDED
+#define EFFECT_HPP_INCLUDED
+
+#include <stdint.h>
+
+/**
+ * The effects applied by a module to its character, timed by the RTC ticks.
+ * An effect is selected by an attribute code sent before the character.
+ * Once received, effects cost no link bandwidth.
+ */
+namespace effect {
+
+    /**
+     * Attribute codes are 0x10..0x1F (0b0001rree):
+     * ee selects the effect, rr the period (16, 32, 64 or 128 ticks).
+     */
+    namespace attribute {
+        constexpr uint8_t steady = 0x10; // the character is always on
+        constexpr uint8_t blink  = 0x11; // on for half the period
+        constexpr uint8_t pulse  = 0x12; // on for an eighth of the period
+        constexpr uint8_t fade   = 0x13; // the brightness rises and falls
+
+        // not an attribute code: the character code is a segment map, shown steady
+        constexpr uint8_t raw    = 0x20;
+
+        constexpr uint8_t effect_mask = 0x03;
+        constexpr uint8_t rate_mask   = 0x0C;
+        constexpr uint8_t rate_shift  = 2;
+    }
+
+    /**
+     * Checks whether a message unit is an attribute code.
+     * @param unit The message unit to check.
+     * @return true if the message unit is an attribute code, false otherwise.
+     */
+    inline bool is_attribute(uint8_t unit) {
+        return (unit & 0xF0) == attribute::steady;
+    }
+
+    /**
+     * Displays a character with an effect.
+     * @param code The ASCII code of the character to display,
+     *             or the segment map with attribute::raw.
+     * @param attribute The attribute code of the effect, attribute::raw,
+     *                  any other value shows the character steady.
+     */
+    void show(char code, uint8_t attribute);
+
+    /**
+     * Sets the brightness of the display.
+     * The fade effect varies the brightness up to this level.
+     * @param level The brightness level.
+     * @see display::set_brightness()
+     */
+    void set_brightness(uint8_t level);
+
+    /**
+     * Runs the effect.
+     * Call this function in the main loop.
+     */
+    void run();
+
+}
+
+#endif /* EFFECT_HPP_INCLUDED */
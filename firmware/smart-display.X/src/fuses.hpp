@@ -31,8 +31,8 @@
 
 namespace fuses {
     enum class id: uint8_t {
-        fuse0,
-        fuse1,
+        fuse0, // self-similar (root) mode
+        fuse1, // store-and-forward mode
         fuse2,
         fuse3, // shared with the key module
     };
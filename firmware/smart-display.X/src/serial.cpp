@@ -27,10 +27,16 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
+#include "command.hpp"
+#include "effect.hpp"
+#include "protocol.hpp"
 #include "serial.hpp"
+#include "telemetry.hpp"
+#include "timer.hpp"
 
 /**
- * The protocol speed in bits per seconds.
+ * The protocol speed in bits per seconds, until an auto-baud locks
+ * onto the speed of the host.
  */
 constexpr uint16_t UART_BPS = 19200;
 
@@ -39,11 +45,28 @@ constexpr uint16_t UART_BPS = 19200;
  */
 constexpr uint16_t PROTOCOL_TIMEOUT_MS = 50;
 
-constexpr uint16_t uart_baud(uint16_t bps) {
-    // original formula from Microchip TB3216:
-    // return ( (F_CPU * 64 / (16 * (float)bps) + 0.5);
-	return (uint16_t)((float)F_CPU * 4 / bps + 0.5);
-}
+/**
+ * The parity of the message units.
+ * Set to USART_PMODE_EVEN_gc to check each unit
+ * (the host must then use the 8E1 framing).
+ */
+constexpr uint8_t UART_PARITY = USART_PMODE_DISABLED_gc;
+
+/**
+ * The size of the TX queue used in store-and-forward mode.
+ * Must be a power of 2.
+ */
+constexpr uint8_t TX_QUEUE_SIZE = 64;
+
+/**
+ * In mirror mode, a message ending with this code synchronises the timers
+ * of all the modules when the protocol timeout elapses: since the last
+ * message unit is mirrored to every module at the same time,
+ * so is the timeout.
+ */
+constexpr uint8_t SYNC_CODE = command::code::sync;
+
+constexpr uint8_t RX_ERRORS = USART_BUFOVF_bm | USART_FERR_bm | USART_PERR_bm;
 
 constexpr uint16_t tca_top(uint16_t ms) { // assumes CLKSEL = DIV16
 	return (uint16_t)((float)F_CPU * ms / 16000 + 0.5);
@@ -94,6 +117,14 @@ inline void setup_ccl() {
 	CCL.CTRLA = CCL_RUNSTDBY_bm;
 }
 
+inline void setup_forwarding_ccl() {
+	CCL.TRUTH0 = 0xAA; // IN0=0 -> OUT=0, IN0=1 -> OUT=1 (CCLO mirrors TX)
+	CCL.LUT0CTRLC = CCL_INSEL2_MASK_gc;
+	CCL.LUT0CTRLB = CCL_INSEL1_MASK_gc | CCL_INSEL0_USART0_gc;
+	CCL.LUT0CTRLA = CCL_OUTEN_bm | CCL_ENABLE_bm;
+	CCL.CTRLA = CCL_RUNSTDBY_bm | CCL_ENABLE_bm;
+}
+
 inline void start_ccl() {
 	CCL.CTRLA = CCL_RUNSTDBY_bm | CCL_ENABLE_bm;
 }
@@ -102,84 +133,307 @@ inline void stop_ccl() {
 	CCL.CTRLA = CCL_RUNSTDBY_bm;
 }
 
-inline void setup_usart() {
+/**
+ * The steps of the break and sync field sent to the next module
+ * in forward mode, driven by the DRE and TXC IRQs.
+ */
+enum class tx_break : uint8_t {
+    none,  // the queue is sent
+    drain, // the units queued before the sync field are sent
+    low    // a null unit sent at half speed holds the line low
+};
+
+/**
+ * The speed locked by the last auto-baud: BAUD is doubled during a break.
+ */
+static volatile uint16_t locked_baud;
+
+inline void setup_usart(serial::mode link_mode, uint16_t baud) {
     // give USART RXC IRQ the maximum priority to minimise latency
     CPUINT.LVL1VEC = USART0_RXC_vect_num;
 
-	USART0.BAUD = uart_baud(UART_BPS);
-	USART0.CTRLC = USART_CHSIZE_8BIT_gc;
-	USART0.CTRLB = USART_TXEN_bm | USART_RXEN_bm;
-	USART0.CTRLA = USART_RXCIE_bm | USART_TXCIE_bm;
+	locked_baud = baud ? baud : protocol::uart_baud(UART_BPS);
+	USART0.BAUD = locked_baud;
+	USART0.CTRLC = UART_PARITY | USART_CHSIZE_8BIT_gc;
+	// RXMODE = GENAUTO: a break followed by the 0x55 sync field sets BAUD
+	USART0.CTRLB = USART_TXEN_bm | USART_RXEN_bm | USART_RXMODE_GENAUTO_gc;
+	if (link_mode == serial::mode::forward) {
+		// TX is driven by the DRE IRQ when the queue is not empty
+		USART0.CTRLA = USART_RXCIE_bm;
+	} else {
+		USART0.CTRLA = USART_RXCIE_bm | USART_TXCIE_bm;
+	}
 }
 
 static volatile bool first;
 static volatile bool error;
 static volatile bool changed;
 
-static volatile uint8_t temp;
 static volatile uint8_t rx_code;
+static volatile uint8_t rx_attr;
+static uint8_t prefix_attr;
+static uint8_t last_unit;
+
+static volatile uint16_t rx_errors;
+static volatile uint16_t dropped;
+static volatile bool baud_changed;
 
 static uint8_t tx_code;
 static uint8_t tx_map;
 static uint8_t tx_index;
+static uint8_t tx_attr;
+static bool tx_prefixed;
+
+static volatile uint8_t tx_queue[TX_QUEUE_SIZE];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+static volatile tx_break break_state;
+static uint8_t break_mark;
+static bool tx_sent;
 
+static bool forwarding;
 static bool inited;
 
 ISR(TCA0_OVF_vect) {
-    stop_ccl();
+    const uint16_t start = telemetry::enter();
+    if (!forwarding) stop_ccl();
 	stop_timer();
 	first = true;
 	error = false;
 	changed = false;
+	prefix_attr = 0;
+	if (forwarding) {
+		command::end_message();
+	} else if (last_unit == SYNC_CODE) {
+		timer::sync(0);
+	}
+	last_unit = 0;
+	telemetry::leave(telemetry::isr::tca, start);
+}
+
+ISR(USART0_DRE_vect) {
+    USART0.TXDATAL = tx_queue[tx_tail];
+    tx_tail = (tx_tail + 1) & (TX_QUEUE_SIZE - 1);
+    // a pending break waits for the units queued before the sync field only
+    const bool draining = break_state == tx_break::drain;
+    if (tx_tail == (draining ? break_mark : tx_head)) {
+        USART0.CTRLA &= ~USART_DREIE_bm;
+        // TXCIF is set again when the last unit has been shifted out
+        USART0.STATUS = USART_TXCIF_bm;
+        tx_sent = true;
+        if (draining) USART0.CTRLA |= USART_TXCIE_bm;
+    }
+}
+
+/**
+ * Sends the next step of a break and sync field once TX is idle,
+ * since BAUD cannot be changed while a unit is shifted out.
+ */
+inline void send_break_step() {
+    USART0.STATUS = USART_TXCIF_bm;
+    if (break_state == tx_break::drain) {
+        // a null unit sent at half speed holds the line low for 18 bit times
+        USART0.BAUD = locked_baud << 1;
+        USART0.TXDATAL = 0;
+        break_state = tx_break::low;
+    } else {
+        USART0.BAUD = locked_baud;
+        USART0.TXDATAL = 0x55;
+        break_state = tx_break::none;
+        USART0.CTRLA &= ~USART_TXCIE_bm;
+        // the units received meanwhile follow the sync field
+        if (tx_tail != tx_head) USART0.CTRLA |= USART_DREIE_bm;
+    }
+}
+
+inline void send_mapped_char() {
+    if (tx_attr && !tx_prefixed) {
+        USART0.TXDATAL = tx_attr;
+        tx_prefixed = true;
+    } else {
+        USART0.TXDATAL = tx_map & (1 << tx_index) ? tx_code : ' ';
+        tx_prefixed = false;
+    }
 }
 
 ISR(USART0_TXC_vect) {
+    // in forward mode, TXC is only enabled to send a break
+    if (forwarding) {
+        send_break_step();
+        return;
+    }
     USART0.STATUS |= USART_TXCIF_bm;
     // bit 7 is ignored: no message unit is transmitted for the DP state
-    if (tx_index < 6) {
+    if (tx_prefixed) {
+        send_mapped_char();
+    } else if (tx_index < 6) {
         ++tx_index;
-        USART0.TXDATAL = tx_map & (1 << tx_index) ? tx_code : ' ';
+        send_mapped_char();
     }
 }
 
-ISR(USART0_RXC_vect) {
-    start_ccl();
+inline bool is_break(uint8_t status, uint8_t data) {
+    // the line is held low for longer than a unit
+    return (status & USART_FERR_bm) && !data;
+}
+
+/**
+ * Checks whether the received unit is the sync field of an auto-baud.
+ * Must be called before the next unit is read.
+ */
+inline bool is_sync_field() {
+    const uint8_t status = USART0.STATUS;
+    if (status & USART_ISFIF_bm) {
+        // the sync field was inconsistent, BAUD is unchanged
+        USART0.STATUS = USART_ISFIF_bm;
+        ++rx_errors;
+    }
+    if (!(status & USART_BDF_bm)) return false;
+    USART0.STATUS = USART_BDF_bm;
+    locked_baud = USART0.BAUD;
+    baud_changed = true;
+    return true;
+}
+
+/**
+ * In forward mode, sends a break and a sync field to the next module,
+ * at the speed just locked, after the units already queued.
+ * Since BAUD is shared with the receiver, the host must leave the link
+ * idle for a while after the sync field.
+ */
+inline void forward_sync_field() {
+    break_mark = tx_head;
+    break_state = tx_break::drain;
+    // otherwise the DRE IRQ enables TXC once the queue is drained
+    if (USART0.CTRLA & USART_DREIE_bm) return;
+    if (tx_sent) {
+        // TXCIF is set if the last unit has already been shifted out
+        USART0.CTRLA |= USART_TXCIE_bm;
+    } else {
+        send_break_step();
+    }
+}
+
+inline void receive_forwarded() {
 	reset_timer();
-	if (error) {
-        temp = USART0.RXDATAL;	// empties RX buffer and forces clear status bits
-    } else if (USART0.RXDATAH & (USART_BUFOVF_bm | USART_FERR_bm)) {
-        temp = USART0.RXDATAL;	// empties RX buffer and forces clear status bits
-        error = true;
+    // status must be read before data, since reading data pops the RX buffer
+    const uint8_t status = USART0.RXDATAH;
+    const uint8_t data = USART0.RXDATAL;
+    if (is_break(status, data)) return;
+    if (is_sync_field()) {
+        forward_sync_field();
+        return;
+    }
+    if (first) {
+        start_timer();
+        first = false;
+    }
+    if (status & RX_ERRORS) {
+        ++rx_errors;
+        // the rest of the message is ignored until the protocol timeout
+        if (!error) {
+            error = true;
+            command::abort_message();
+        }
+    } else if (!error) {
+        command::receive(data);
+    }
+}
+
+inline void receive_mirrored() {
+    // status must be read before data, since reading data pops the RX buffer
+    const uint8_t status = USART0.RXDATAH;
+    const uint8_t data = USART0.RXDATAL;
+    if (is_break(status, data)) {
+        reset_timer();
+        return;
+    }
+    // the sync field of an auto-baud takes the slot of the module
+    const bool sync_field = is_sync_field();
+    // an attribute code before the character is not mirrored either
+    const bool prefix = first && !prefix_attr && effect::is_attribute(data);
+    if (!prefix) start_ccl();
+	reset_timer();
+    if (status & RX_ERRORS) ++rx_errors;
+    last_unit = status & RX_ERRORS ? 0 : data;
+    if (prefix) {
+        start_timer();
+        prefix_attr = data;
     } else if (first) {
-    	start_timer();
-        rx_code = USART0.RXDATAL;
-        changed = true;
+        if (!prefix_attr) start_timer();
         first = false;
+        if (status & RX_ERRORS) {
+            // the last good character stays displayed
+            ++dropped;
+        } else if (data != SYNC_CODE && !sync_field) {
+            // a module after the end of the text only sees the sync code
+            rx_code = data;
+            rx_attr = prefix_attr;
+            changed = true;
+        }
+    }
+}
+
+ISR(USART0_RXC_vect) {
+    const uint16_t start = telemetry::enter();
+    if (forwarding) {
+        receive_forwarded();
     } else {
-        temp = USART0.RXDATAL;	// empties RX buffer and forces clear status bits
+        receive_mirrored();
     }
+    telemetry::leave(telemetry::isr::rxc, start);
 }
 
 namespace serial {
 
-	void init() {
+	void init(mode link_mode, uint16_t baud) {
         // ensure that initialisation is done once
         if (inited) return;
 
 		first = true;
 		error = false;
 		changed = false;
+		forwarding = link_mode == mode::forward;
 
 		setup_timer();
 		setup_ports();
-		setup_ccl();
-		setup_usart();
+		if (forwarding) {
+			setup_forwarding_ccl();
+		} else {
+			setup_ccl();
+		}
+		setup_usart(link_mode, baud);
 
         inited = true;
 	}
 
-	bool has_errors() {
-		return error;
+	bool has_baud() {
+		return baud_changed;
+	}
+
+	uint16_t get_baud() {
+		baud_changed = false;
+		return locked_baud;
+	}
+
+	uint16_t unit_time_us() {
+        // 1 start bit, 8 data bits, 1 stop bit (and 1 parity bit)
+        constexpr uint8_t bits = UART_PARITY == USART_PMODE_DISABLED_gc ? 10 : 11;
+        // bit time = BAUD / (4 * F_CPU), see protocol::uart_baud()
+        return (uint32_t)locked_baud * bits * 1000 / (F_CPU / 250);
+	}
+
+	counters get_counters() {
+        counters result;
+        USART0.CTRLA &= ~USART_RXCIE_bm;
+        result.rx_errors = rx_errors;
+        result.dropped = dropped;
+        USART0.CTRLA |= USART_RXCIE_bm;
+        return result;
+	}
+
+	void count_dropped() {
+        ++dropped;
 	}
 
 	bool has_data() {
@@ -191,11 +445,31 @@ namespace serial {
 		return rx_code;
 	}
 
-	void enqueue_mapped_chars(uint8_t code, uint8_t map) {
+	uint8_t get_attribute() {
+		return rx_attr;
+	}
+
+	void enqueue_mapped_chars(uint8_t code, uint8_t map, uint8_t attribute) {
         tx_code = code;
         tx_map = map;
+        tx_attr = attribute;
         tx_index = 1;
+        tx_prefixed = false;
         while (!(USART0.STATUS & USART_DREIF_bm)) ;
-        USART0.TXDATAL = map & (1 << 1) ? code : ' ';
+        send_mapped_char();
+    }
+
+	void forward(uint8_t code) {
+        const uint8_t next = (tx_head + 1) & (TX_QUEUE_SIZE - 1);
+        // a command may expand as it is forwarded, like a QUERY that
+        // each module appends a report to: the lost unit spoils the message
+        if (next == tx_tail) {
+            ++dropped;
+            return;
+        }
+        tx_queue[tx_head] = code;
+        tx_head = next;
+        // a break in progress resumes the queue when done
+        if (break_state == tx_break::none) USART0.CTRLA |= USART_DREIE_bm;
     }
 }
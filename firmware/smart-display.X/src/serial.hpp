@@ -27,26 +27,77 @@
 #ifndef SERIAL_HPP_INCLUDED
 #define SERIAL_HPP_INCLUDED
 
+#include <stdint.h>
+
 namespace serial {
 
+    enum class mode: uint8_t {
+        mirror,  // the first message unit is kept, CCL mirrors the others
+        forward, // each message unit is decoded and forwarded through TX
+    };
+
     /**
      * Initialises the hardware resources related to the communication ports.
      * GPIO: PA1, PA2, PA4.
      * USART: USART0.
      * CCL: LUT0.
      * Timer A: TCA0.
+     * In mirror mode, the CCL output mirrors RX after the first message unit.
+     * In forward (store-and-forward) mode, the CCL output mirrors TX and
+     * each received message unit is passed to the command decoder.
+     * The USART locks onto the speed of the host when it receives a break
+     * followed by a sync field (0x55). In mirror mode, the sync field takes
+     * the slot of the module and the next ones are mirrored, so the host
+     * sends one per module. In forward mode, each module sends a new break
+     * and sync field to the next one.
+     * @param link_mode The link mode.
+     * @param baud The USART BAUD value, or 0 for the default speed.
+     */
+	void init(mode link_mode = mode::mirror, uint16_t baud = 0);
+
+    /**
+     * Checks whether an auto-baud locked onto a new speed.
+     * @return true if BAUD was set by an auto-baud, false otherwise.
+     */
+	bool has_baud();
+
+    /**
+     * Gets the USART BAUD value.
+     * @return The BAUD value.
+     */
+	uint16_t get_baud();
+
+    /**
+     * Gets the time needed to transmit one message unit.
+     * @return The transmission time of one message unit in microseconds.
      */
-	void init();
+	uint16_t unit_time_us();
 
     /**
-     * Checks if any communication error occurred.
+     * The error counters of the link.
      * Since the protocol doesn't use any handshake, protocol errors
-     * are limited to message framing and RX buffer overflows.
-     * Any error condition is maintained until the protocol timeout has elapsed.
-     * Normal communication is then resumed.
-     * @return true if any error occurred, false otherwise.
+     * are limited to message framing, parity and RX buffer overflows.
+     * A message with errors is dropped and the last good character
+     * stays displayed. Normal communication is resumed with the next
+     * message, after the protocol timeout has elapsed.
+     * Counters wrap around.
      */
-	bool has_errors();
+    struct counters {
+        uint16_t rx_errors; // message units received with errors
+        uint16_t dropped;   // messages dropped because of errors or a full TX queue
+    };
+
+    /**
+     * Gets the error counters of the link.
+     * @return The error counters.
+     */
+	counters get_counters();
+
+    /**
+     * Counts a message dropped by the command decoder.
+     * Called from the RX IRQ handler.
+     */
+	void count_dropped();
 
     /**
      * Checks whether a character to display was received.
@@ -64,6 +115,14 @@ namespace serial {
      */
 	uint8_t get_data();
 
+    /**
+     * Gets the attribute code received before the last character code.
+     * In mirror mode, the slot of a module is an optional attribute code
+     * (@see effect::attribute) followed by the character code.
+     * @return The attribute code, or 0 if none was received.
+     */
+	uint8_t get_attribute();
+
     /**
      * In self-similar mode, computes the effective
      * character code to show on this module's display.
@@ -82,8 +141,19 @@ namespace serial {
      * Standard message is forwarded through the CCL data path.
      * @param code The received character code.
      * @param map The segment map corresponding to the received character code.
+     * @param attribute The attribute code to send before each character code,
+     *                  or 0 if none.
+     */
+	void enqueue_mapped_chars(uint8_t code, uint8_t map, uint8_t attribute);
+
+    /**
+     * In forward mode, enqueues a message unit for the next module
+     * of the chain. Message units are sent in order through the UART TX.
+     * A unit that does not fit in the queue is lost and counted as dropped.
+     * May be called from the RX IRQ handler.
+     * @param code The message unit to send.
      */
-	void enqueue_mapped_chars(uint8_t code, uint8_t map);
+	void forward(uint8_t code);
 
 }
 
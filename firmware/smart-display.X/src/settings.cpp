@@ -0,0 +1,192 @@
+/* 
+ * File:   settings.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <avr/eeprom.h>
+
+#include <stdint.h>
+
+#include "settings.hpp"
+#include "timer.hpp"
+
+/**
+ * The lowest valid BAUD value of the USART in normal mode.
+ */
+constexpr uint16_t MIN_BAUD = 64;
+
+/**
+ * The time a glyph must be shown before it is persisted.
+ * At most one slot is written every PERSIST_DELAY_SECS: with GLYPH_SLOTS
+ * slots of 100k write cycles each, the EEPROM lasts about 1.5 years
+ * of glyphs changing every 30 s, and much longer in real use.
+ */
+constexpr uint16_t PERSIST_DELAY_SECS = 30;
+
+/**
+ * The number of slots of the ring of persisted glyphs.
+ */
+constexpr uint8_t GLYPH_SLOTS = 16;
+
+/**
+ * The sequence numbers of the slots run from 1 to MAX_SEQUENCE, so that
+ * neither an erased (0xFF) nor a cleared (0) slot is valid.
+ * Consecutive slots hold consecutive numbers up to the last glyph written.
+ */
+constexpr uint8_t MAX_SEQUENCE = 0x7F;
+
+constexpr uint8_t PERSISTENCE_ENABLED = 0x01;
+
+struct glyph_slot {
+    uint8_t sequence;
+    uint8_t code;
+    uint8_t attr;
+};
+
+static uint16_t EEMEM baud_setting = 0xFFFF;
+static uint8_t EEMEM splash_code = 0xFF;
+static uint8_t EEMEM splash_attr = 0xFF;
+static uint8_t EEMEM persistence_setting = 0xFF;
+static glyph_slot EEMEM glyph_ring[GLYPH_SLOTS];
+
+static bool loaded;
+static bool persistence;
+static uint8_t last_slot;     // the slot of the last glyph written
+static bool pending;          // a glyph waits to be written
+static settings::glyph pending_glyph;
+static uint16_t pending_since;
+
+inline uint8_t read_sequence(uint8_t slot) {
+    return eeprom_read_byte(&glyph_ring[slot].sequence);
+}
+
+inline bool is_valid(uint8_t sequence) {
+    return sequence && sequence <= MAX_SEQUENCE;
+}
+
+inline uint8_t next_sequence(uint8_t sequence) {
+    return sequence % MAX_SEQUENCE + 1;
+}
+
+/**
+ * Finds the slot of the last glyph written, which is followed by an
+ * erased slot or by a slot that does not continue its sequence.
+ * @return The last slot, or GLYPH_SLOTS if no glyph was written.
+ */
+static uint8_t find_last_slot() {
+    for (uint8_t slot = 0; slot < GLYPH_SLOTS; ++slot) {
+        const uint8_t sequence = read_sequence(slot);
+        if (!is_valid(sequence)) continue;
+        const uint8_t next = read_sequence((slot + 1) % GLYPH_SLOTS);
+        if (next != next_sequence(sequence)) return slot;
+    }
+    return GLYPH_SLOTS;
+}
+
+inline void load() {
+    if (loaded) return;
+    persistence = eeprom_read_byte(&persistence_setting) == PERSISTENCE_ENABLED;
+    last_slot = find_last_slot();
+    loaded = true;
+}
+
+static void write_glyph(const settings::glyph& shown) {
+    uint8_t sequence = 1;
+    uint8_t slot = 0;
+    if (last_slot < GLYPH_SLOTS) {
+        settings::glyph last;
+        // the glyph is unchanged: no need to wear another slot
+        if (settings::get_last_glyph(last) && last.code == shown.code && last.attr == shown.attr) return;
+        sequence = next_sequence(read_sequence(last_slot));
+        slot = (last_slot + 1) % GLYPH_SLOTS;
+    }
+    // the sequence number is written last, so that a power loss
+    // in the middle of the update leaves the previous glyph valid
+    eeprom_update_byte(&glyph_ring[slot].code, shown.code);
+    eeprom_update_byte(&glyph_ring[slot].attr, shown.attr);
+    eeprom_update_byte(&glyph_ring[slot].sequence, sequence);
+    last_slot = slot;
+}
+
+namespace settings {
+
+    uint16_t get_baud() {
+        const uint16_t baud = eeprom_read_word(&baud_setting);
+        // an erased EEPROM reads as 0xFFFF
+        return baud >= MIN_BAUD && baud != 0xFFFF ? baud : 0;
+    }
+
+    void set_baud(uint16_t baud) {
+        const uint16_t saved = get_baud();
+        const uint16_t delta = baud > saved ? baud - saved : saved - baud;
+        if (delta > saved >> 6) eeprom_update_word(&baud_setting, baud);
+    }
+
+    bool get_splash(glyph& splash) {
+        splash.code = eeprom_read_byte(&splash_code);
+        splash.attr = eeprom_read_byte(&splash_attr);
+        return splash.code != 0xFF;
+    }
+
+    void set_splash(const glyph& splash) {
+        eeprom_update_byte(&splash_code, splash.code);
+        eeprom_update_byte(&splash_attr, splash.attr);
+    }
+
+    bool get_persistence() {
+        load();
+        return persistence;
+    }
+
+    void set_persistence(bool enabled) {
+        load();
+        persistence = enabled;
+        pending = false;
+        eeprom_update_byte(&persistence_setting, enabled ? PERSISTENCE_ENABLED : 0);
+    }
+
+    bool get_last_glyph(glyph& last) {
+        load();
+        if (last_slot >= GLYPH_SLOTS) return false;
+        last.code = eeprom_read_byte(&glyph_ring[last_slot].code);
+        last.attr = eeprom_read_byte(&glyph_ring[last_slot].attr);
+        return true;
+    }
+
+    void save_glyph(const glyph& shown) {
+        load();
+        if (!persistence) return;
+        pending_glyph = shown;
+        pending_since = timer::seconds();
+        pending = true;
+    }
+
+    void run() {
+        if (!pending) return;
+        if ((uint16_t)(timer::seconds() - pending_since) < PERSIST_DELAY_SECS) return;
+        pending = false;
+        write_glyph(pending_glyph);
+    }
+
+}
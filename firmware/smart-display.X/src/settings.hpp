@@ -0,0 +1,106 @@
+/* 
+ * File:   settings.hpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SETTINGS_HPP_INCLUDED
+#define SETTINGS_HPP_INCLUDED
+
+#include <stdint.h>
+
+/**
+ * The settings of the module, persisted in the EEPROM.
+ */
+namespace settings {
+
+    /**
+     * A character code and the attribute code of its effect.
+     */
+    struct glyph {
+        uint8_t code;
+        uint8_t attr;
+    };
+
+    /**
+     * Gets the USART baud register value locked by the last auto-baud.
+     * @return The BAUD value, or 0 if none was saved.
+     */
+    uint16_t get_baud();
+
+    /**
+     * Saves the USART baud register value locked by an auto-baud.
+     * The EEPROM is written only if the value differs from the saved one
+     * by more than the tolerance of the auto-baud (about 1.5%).
+     * @param baud The BAUD value.
+     */
+    void set_baud(uint16_t baud);
+
+    /**
+     * Gets the glyph shown at boot when no last glyph is persisted.
+     * @param splash Set to the splash glyph.
+     * @return true if a splash glyph was saved, false otherwise.
+     */
+    bool get_splash(glyph& splash);
+
+    /**
+     * Saves the glyph shown at boot.
+     * @param splash The splash glyph.
+     */
+    void set_splash(const glyph& splash);
+
+    /**
+     * Checks whether the last glyph shown is persisted across power cycles.
+     */
+    bool get_persistence();
+
+    /**
+     * Enables or disables the persistence of the last glyph shown.
+     * @param enabled true to persist the last glyph, false otherwise.
+     */
+    void set_persistence(bool enabled);
+
+    /**
+     * Gets the last glyph persisted.
+     * @param last Set to the last glyph.
+     * @return true if a glyph was persisted, false otherwise.
+     */
+    bool get_last_glyph(glyph& last);
+
+    /**
+     * Persists the glyph shown, if the persistence is enabled.
+     * To limit the wear of the EEPROM, the glyph is written by run()
+     * once it was shown for PERSIST_DELAY_SECS, in the next slot of a ring.
+     * @param shown The glyph shown.
+     */
+    void save_glyph(const glyph& shown);
+
+    /**
+     * Writes the glyph to persist when due.
+     * Called from the main loop.
+     */
+    void run();
+
+}
+
+#endif /* SETTINGS_HPP_INCLUDED */
@@ -26,57 +26,115 @@
 
 #include <stdint.h>
 
+#include "command.hpp"
 #include "cpu.hpp"
 #include "display.hpp"
+#include "effect.hpp"
 #include "fuses.hpp"
 #include "serial.hpp"
+#include "settings.hpp"
+#include "telemetry.hpp"
 #include "timer.hpp"
 
-constexpr uint8_t FLASH_SPEED = 5;
-constexpr uint8_t ERR_CHAR = 'E';
+/**
+ * Checks whether this module decodes and forwards messages
+ * (store-and-forward mode) instead of mirroring them.
+ * The self-similar mode takes precedence, since it uses the UART TX.
+ */
+inline bool forward_node() {
+    return fuses::get_state(fuses::id::fuse1)
+        && !fuses::get_state(fuses::id::fuse0);
+}
 
-inline void error_loop() {
-    uint8_t tick = 0;
-    timer::enable(FLASH_SPEED);
-    display::show_char(ERR_CHAR);
-    do {
-        if (timer::elapsed()) {
-            timer::enable(FLASH_SPEED);
-            display::show_char(tick & 1 ? ERR_CHAR : ' ');
-            ++tick;
-        }
-        // TODO: idle CPU
-    } while (serial::has_errors());
-    display::off();
+static bool root_node;
+static bool forward;
+static settings::glyph shown;
+
+inline void show(uint8_t code, uint8_t attr) {
+    shown.code = code;
+    shown.attr = attr;
+    effect::show(code, attr);
+    settings::save_glyph(shown);
+}
+
+/**
+ * Saves the settings of a STORE command.
+ */
+inline void store(uint8_t flags) {
+    if (flags & command::store::splash) settings::set_splash(shown);
+    if (flags & command::store::persist) {
+        settings::set_persistence(true);
+        settings::save_glyph(shown);
+    } else if (flags & command::store::no_persist) {
+        settings::set_persistence(false);
+    }
+}
+
+/**
+ * Shows the last glyph persisted or the splash glyph,
+ * so that the module is not blank until the host sends a message.
+ */
+inline void show_boot_glyph() {
+    settings::glyph boot;
+    if ((settings::get_persistence() && settings::get_last_glyph(boot))
+            || settings::get_splash(boot)) {
+        shown = boot;
+        effect::show(boot.code, boot.attr);
+    }
 }
 
 namespace smart_display {
 
     void init() {
+        cpu::setup_clock();
         cpu::irq_roundrobin();
         timer::init();
+        telemetry::init();
         fuses::init();
         display::init();
-        serial::init();
+        serial::init(
+            forward_node() ? serial::mode::forward : serial::mode::mirror,
+            settings::get_baud());
+        root_node = fuses::get_state(fuses::id::fuse0);
+        forward = forward_node();
+        show_boot_glyph();
     }
 
-    void run() {
-        bool root_node = fuses::get_state(fuses::id::fuse0);
-
-        for (;;) {
-            if (serial::has_errors()) {
-                error_loop();
-            } else if (serial::has_data()) {
-                if (root_node) {
-                    uint8_t code = serial::get_data();
-                    uint8_t map = display::char_to_segs(code);
-                    serial::enqueue_mapped_chars(code, map);
-                    display::show_char(serial::get_root_char(code, map));
-                } else {
-                    display::show_char(serial::get_data());
-                }
+    void step() {
+        if (forward) {
+            if (command::has_brightness()) {
+                effect::set_brightness(command::get_brightness());
+            }
+            // the glyph committed with the STORE is shown first
+            const bool has_store = command::has_store();
+            if (command::has_data()) {
+                uint8_t code = command::get_data();
+                show(code, command::get_attribute());
+            }
+            if (has_store) {
+                store(command::get_store());
             }
+        } else if (serial::has_data()) {
+            uint8_t code = serial::get_data();
+            uint8_t attr = serial::get_attribute();
+            if (root_node) {
+                uint8_t map = display::char_to_segs(code);
+                serial::enqueue_mapped_chars(code, map, attr);
+                show(serial::get_root_char(code, map), attr);
+            } else {
+                show(code, attr);
+            }
+        }
+        if (serial::has_baud()) {
+            settings::set_baud(serial::get_baud());
         }
+        settings::run();
+        effect::run();
+        telemetry::run();
+    }
+
+    void run() {
+        for (;;) step();
     }
     
 }
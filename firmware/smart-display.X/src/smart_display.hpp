@@ -33,6 +33,12 @@ namespace smart_display {
      */
     void init();
 
+    /**
+     * Runs one iteration of the main loop: shows the data received
+     * and updates the effects. Never waits.
+     */
+    void step();
+
     /**
      * Runs the application.
      * Never returns.
@@ -1,48 +0,0 @@
-/* 
- * File:   utilities.cpp
- * Author: Gabriele Falcioni <foss.dev@falcioni.net>
- *
- * Copyright 2022 Gabriele Falcioni
- *
- * Permission is hereby granted, free of charge, to any person
- * obtaining a copy of this software and associated documentation files
- * (the "Software"), to deal in the Software without restriction,
- * including without limitation the rights to use, copy, modify, merge,
- * publish, distribute, sublicense, and/or sell copies of the Software,
- * and to permit persons to whom the Software is furnished to do so,
- * subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included
- * in all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
- * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
- * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
- * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
- * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
- * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
- * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
- */
-
-#include <stdlib.h>
-#include <string.h>
-
-#include <avr/pgmspace.h>
-
-#include "utilities.hpp"
-
-void str_builder::clear() {
-    len = 0;
-    buf[0] = 0;
-}
-
-void str_builder::append_progmem(const void* ptr, size_t size) {
-    memcpy_P(buf + len, ptr, size);
-    len += size;
-    buf[len] = 0;
-}
-
-void str_builder::append_uint(unsigned int value) {
-    utoa(value, buf + len, 10);
-    len += strlen(buf + len);
-}
@@ -0,0 +1,212 @@
+/* 
+ * File:   framebuffer.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined( __linux__ )
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "framebuffer.h"
+
+/* --------------------------------------------------------------------- */
+
+#if defined( __linux__ )
+
+// the futex is shared between processes, so it is not private
+static void futex_wait(uint32_t* word, uint32_t seen, long timeout_ms) {
+	struct timespec ts = {
+		timeout_ms / 1000,          // tv_sec
+		timeout_ms % 1000 * 1000000 // tv_nsec
+	};
+	syscall(SYS_futex, word, FUTEX_WAIT, seen, &ts, NULL, 0);
+}
+
+static void futex_wake(uint32_t* word) {
+	syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+#else
+
+/**
+ * The poll interval of the doorbell where futexes are not available.
+ */
+constexpr long POLL_INTERVAL_MS = 1;
+
+static void futex_wait(uint32_t* word, uint32_t seen, long timeout_ms) {
+	struct timespec ts = { 0, POLL_INTERVAL_MS * 1000000 };
+	for (long waited = 0; waited < timeout_ms; waited += POLL_INTERVAL_MS) {
+		if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != seen) return;
+		nanosleep(&ts, NULL);
+	}
+}
+
+static void futex_wake(uint32_t*) {
+}
+
+#endif
+
+namespace framebuffer {
+
+	shared::shared() {
+		fh = -1;
+		memory = NULL;
+		size = 0;
+		module_count = 0;
+	}
+
+	shared::~shared() {
+		close();
+	}
+
+	bool shared::map(size_t length) {
+		void* address = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fh, 0);
+		if (address == MAP_FAILED) {
+			perror(path.c_str());
+			return false;
+		}
+		memory = (header*)address;
+		size = length;
+		return true;
+	}
+
+	bool shared::create(const char* name, int modules) {
+		path = std::string("/ssegs-") + name;
+		fh = shm_open(path.c_str(), O_RDWR | O_CREAT, 0660);
+		if (fh == -1) {
+			perror(path.c_str());
+			return false;
+		}
+
+		struct stat info;
+		size_t length = sizeof(header) + modules;
+		if (fstat(fh, &info) == -1
+		|| ((size_t)info.st_size != length && ftruncate(fh, length) == -1)) {
+			perror(path.c_str());
+			close();
+			return false;
+		}
+
+		if ( ! map(length)) {
+			close();
+			return false;
+		}
+
+		if (memory->magic != MAGIC
+		|| memory->version != VERSION
+		|| memory->modules != modules) {
+			memory->magic = 0;
+			memory->version = VERSION;
+			memory->modules = modules;
+			memory->waiting = 0;
+			memset(glyphs(), ' ', modules);
+			__atomic_store_n(&memory->magic, MAGIC, __ATOMIC_RELEASE);
+		}
+		module_count = modules;
+		return true;
+	}
+
+	bool shared::attach(const char* name) {
+		path = std::string("/ssegs-") + name;
+		fh = shm_open(path.c_str(), O_RDWR, 0);
+		if (fh == -1) {
+			perror(path.c_str());
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fh, &info) == -1 || (size_t)info.st_size < sizeof(header)) {
+			fprintf(stderr, "%s: not a framebuffer\n", path.c_str());
+			close();
+			return false;
+		}
+
+		if ( ! map(info.st_size)) {
+			close();
+			return false;
+		}
+
+		int modules = memory->modules;
+		if (__atomic_load_n(&memory->magic, __ATOMIC_ACQUIRE) != MAGIC
+		|| memory->version != VERSION
+		|| modules > MAX_MODULES
+		|| sizeof(header) + modules > size) {
+			fprintf(stderr, "%s: not a framebuffer of version %u\n", path.c_str(), VERSION);
+			close();
+			return false;
+		}
+		module_count = modules;
+		return true;
+	}
+
+	void shared::close() {
+		if (memory) {
+			munmap(memory, size);
+			memory = NULL;
+			size = 0;
+			module_count = 0;
+		}
+		if (fh != -1) {
+			::close(fh);
+			fh = -1;
+		}
+	}
+
+	/*
+	 * The sequence is incremented before the waiting flag is read,
+	 * while the driver sets the flag before it checks the sequence again:
+	 * either the driver sees the new sequence, or the producer sees the flag.
+	 */
+	void shared::ring() {
+		__atomic_fetch_add(&memory->sequence, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&memory->waiting, __ATOMIC_SEQ_CST)) {
+			futex_wake(&memory->sequence);
+		}
+	}
+
+	bool shared::wait(uint32_t seen, long timeout_ms) {
+		__atomic_store_n(&memory->waiting, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&memory->sequence, __ATOMIC_SEQ_CST) == seen) {
+			futex_wait(&memory->sequence, seen, timeout_ms);
+		}
+		__atomic_store_n(&memory->waiting, 0, __ATOMIC_SEQ_CST);
+		return sequence() != seen;
+	}
+
+	void shared::snapshot(char* frame) const {
+		memcpy(frame, memory + 1, module_count);
+	}
+
+}
@@ -0,0 +1,126 @@
+/* 
+ * File:   framebuffer.h
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef FRAMEBUFFER_H_INCLUDED
+#define FRAMEBUFFER_H_INCLUDED
+
+/* --------------------------------------------------------------------- */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+/* --------------------------------------------------------------------- */
+
+/**
+ * A framebuffer shared with local producers: the shared memory object
+ * /ssegs-NAME (/dev/shm/ssegs-NAME on Linux) holds a header followed by
+ * one character code per module, as sent with --raw
+ * (bit 7 lights the decimal point).
+ * A producer writes its glyphs in place, then rings the doorbell:
+ * it increments the sequence and wakes the driver only if it sleeps on it.
+ * The driver sends the frames which differ from the last one sent,
+ * so the glyphs written while a message is being sent are merged
+ * into the next one.
+ */
+namespace framebuffer {
+
+	constexpr uint32_t MAGIC = 0x42465353; // "SSFB"
+	constexpr uint16_t VERSION = 1;
+	constexpr int MAX_MODULES = 4096;
+	constexpr size_t MAX_NAME_LENGTH = 24; // the path fits in 31 characters on macOS
+
+	struct header {
+		uint32_t magic;    // written last by the driver, once the layout is ready
+		uint16_t version;
+		uint16_t modules;  // the number of character codes after the header
+		uint32_t sequence; // the doorbell, incremented by the producers (futex word)
+		uint32_t waiting;  // 1 while the driver sleeps on the doorbell
+	};
+
+	class shared {
+		std::string path;
+		int         fh;
+		header*     memory;
+		size_t      size;
+		int         module_count; // validated once: the header is writable by producers
+
+		bool map(size_t length);
+
+	public:
+		shared();
+		~shared();
+
+		/**
+		 * Creates the framebuffer, or reuses it if it has the same size,
+		 * so that producers keep their mapping when the driver restarts.
+		 * @return true if the framebuffer is mapped, false otherwise.
+		 */
+		bool create(const char* name, int modules);
+
+		/**
+		 * Maps a framebuffer created by the driver.
+		 * @return true if the framebuffer is mapped, false otherwise.
+		 */
+		bool attach(const char* name);
+
+		void close();
+
+		inline int modules() const {
+			return module_count;
+		}
+
+		inline char* glyphs() {
+			return (char*)(memory + 1);
+		}
+
+		inline uint32_t sequence() const {
+			return __atomic_load_n(&memory->sequence, __ATOMIC_ACQUIRE);
+		}
+
+		/**
+		 * Publishes the glyphs written so far (producers).
+		 */
+		void ring();
+
+		/**
+		 * Sleeps until the sequence differs from seen or the timeout expires (driver).
+		 * @return true if the sequence changed, false otherwise.
+		 */
+		bool wait(uint32_t seen, long timeout_ms);
+
+		/**
+		 * Copies the glyphs published with the last ring (driver).
+		 */
+		void snapshot(char* frame) const;
+	};
+
+}
+
+/* --------------------------------------------------------------------- */
+
+#endif /* FRAMEBUFFER_H_INCLUDED */
@@ -30,9 +30,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <signal.h>
 
 #define APP_VERSION "1.0.0"
 
+#include "framebuffer.h"
+#include "preview.h"
 #include "protocol.h"
 #include "serial.h"
 
@@ -45,9 +48,11 @@ static void print_version(const char* tool_name) {
 
 static void print_usage(const char* tool_name, int help_mode) {
 	fprintf(stderr,
-			"Usage: %s\t[-hrV] [-f FRAMING] [-s BIT_RATE] [-t TIMING] [-w WINDOW]\n"
+			"Usage: %s\t[-CchkMmqrSTVy] [-a MODULES] [-b LEVEL] [-e EFFECT] [-F NAME:MODULES]\n"
+			"\t\t[-f FRAMING] [-g GAP] [-o OFFSET] [-P MODULES] [-p PERSIST] [-s BIT_RATE]\n"
+			"\t\t[-t TIMING] [-w WINDOW]\n"
 		    "\t\tserial_device\n"
-		    "\t\ttext_string\n",
+		    "\t\t[text_string]\n",
 		   tool_name);
 	if (help_mode) {
 		fprintf(stderr,
@@ -55,17 +60,61 @@ static void print_usage(const char* tool_name, int help_mode) {
 				"Sends a text string or the contents of a file to a serial device.\n"
 				"\n"
 				"positional arguments:\n"
-				"serial_device\tthe path to a serial device (example: /dev/cu.usbserial)\n"
-				"text_string\tthe string to send\n"
+				"serial_device\tthe path to a serial device (example: /dev/cu.usbserial),\n"
+				"\t\tnot given with --preview\n"
+				"text_string\tthe string to send (optional with --query, --calibrate and\n"
+				"\t\t--autobaud, not allowed with --framebuffer)\n"
 				"\n"
 				"optional arguments:\n"
 				"-V, --version\tshow program's version number and exit\n"
 				"-h, --help\tshow this help message and exit\n"
+				"-C, --calibrate\tmeasure the length, the delay and the min gap between\n"
+				"\t\tmessages of the chain, the last module must be looped back\n"
+				"\t\tto the serial device, then pace the messages accordingly\n"
+				"\t\t(requires --command)\n"
+				"-c, --command\tencode messages for modules in store-and-forward mode\n"
+				"-k, --check\tend each message with a CRC-8 check (requires --command)\n"
+				"-M, --monitor\tcount the messages committed, dropped or lost by the chain\n"
+				"\t\tfrom their echo, the last module must be looped back to the\n"
+				"\t\tserial device (requires --command and --check)\n"
+				"-m, --marquee\tshift the text into the modules one character at a time,\n"
+				"\t\tevery TIMING_MS (requires --command)\n"
+				"-q, --query\tprint the error counters of each module, the last module\n"
+				"\t\tmust be looped back to the serial device (requires --command)\n"
+				"-T, --telemetry\tlike --query, but print the IRQ cycle budgets of each\n"
+				"\t\tmodule (diagnostic builds only)\n"
 				"-r, --raw\tdo not preprocess text before sending\n"
+				"-S, --splash\tsave the text as the glyphs the modules show at boot\n"
+				"\t\t(requires --command)\n"
+				"-y, --sync\tsynchronise the timers of the modules, which run the\n"
+				"\t\teffects, with the first message\n"
+				"-a MODULES, --autobaud MODULES\n"
+				"\t\tmake the chain of MODULES modules lock onto BIT_RATE\n"
+				"\t\tbefore sending the text\n"
+				"-b LEVEL, --brightness LEVEL\n"
+				"\t\tthe brightness of the modules, from 0 to 7 (requires --command)\n"
+				"-e EFFECT[:RATE], --effect EFFECT[:RATE]\n"
+				"\t\tthe effect of the characters: steady, blink, pulse or fade,\n"
+				"\t\tRATE from 0 (fast) to 3 (slow) (default: 1)\n"
+				"-P MODULES, --preview MODULES\n"
+				"\t\tdraw what a chain of MODULES modules would display in the\n"
+				"\t\tterminal, instead of sending it to a serial device\n"
+				"-p PERSIST, --persist PERSIST\n"
+				"\t\ton: the modules show their last glyph at boot, off: their\n"
+				"\t\tsplash glyph (requires --command)\n"
 				"-s BIT_RATE, --speed BIT_RATE\n"
 				"\t\tthe transmission speed in bps (default: 19200)\n"
+				"-F NAME:MODULES, --framebuffer NAME:MODULES\n"
+				"\t\tshare a framebuffer of MODULES character codes in the shared\n"
+				"\t\tmemory object /ssegs-NAME and send its frames as producers\n"
+				"\t\tpublish them, until interrupted\n"
 				"-f FRAMING, --framing FRAMING\n"
 				"\t\tthe character framing (default: 8N1)\n"
+				"-g GAP_MS, --gap GAP_MS\n"
+				"\t\tthe gap which ends a message in milliseconds (default: 50)\n"
+				"-o OFFSET, --offset OFFSET\n"
+				"\t\tthe module where the text begins, modules before it are left\n"
+				"\t\tunchanged (default: 0, requires --command)\n"
 				"-t TIMING_MS, --timing TIMING_MS\n"
 				"\t\tthe timing between two animation frames in milliseconds (default: 100)\n"
 				"-w SIZE, --window SIZE\n"
@@ -187,64 +236,398 @@ static bool parse_animation_window(protocol::options& opts, const char* value, c
 	}
 }
 
+static bool parse_gap(protocol::options& opts, const char* value, const char* tool_name) {
+	intmax_t gap_ms = strtoimax(value, NULL, 10);
+	if (strlen(value) > 0 && gap_ms > 0 && gap_ms <= 1000) {
+		opts.end_of_message_ms = gap_ms;
+		return true;
+	} else {
+		fprintf(stderr,
+				"%s: error: '%s' is an invalid gap, "
+				"please specify an unsigned integer less or equal to 1000 ms\n",
+				tool_name,
+				value);
+		return false;
+	}
+}
+
+static bool parse_preview(preview::terminal& terminal, const protocol::options& opts, const char* value, const char* tool_name) {
+	intmax_t modules = strtoimax(value, NULL, 10);
+	if (strlen(value) > 0 && modules > 0 && modules <= 255) {
+		terminal.set_chain(modules, opts.command);
+		return true;
+	} else {
+		fprintf(stderr,
+				"%s: error: '%s' is an invalid number of modules, "
+				"please specify a positive integer less or equal to 255\n",
+				tool_name,
+				value);
+		return false;
+	}
+}
+
+static bool parse_offset(protocol::options& opts, const char* value, const char* tool_name) {
+	intmax_t offset = strtoimax(value, NULL, 10);
+	if (strlen(value) > 0 && offset >= 0 && offset <= 4096) {
+		opts.offset = offset;
+		return true;
+	} else {
+		fprintf(stderr,
+				"%s: error: '%s' is an invalid offset, "
+				"please specify an unsigned integer less or equal to 4096\n",
+				tool_name,
+				value);
+		return false;
+	}
+}
+
+static bool parse_autobaud(protocol::options& opts, const char* value, const char* tool_name) {
+	intmax_t modules = strtoimax(value, NULL, 10);
+	if (strlen(value) > 0 && modules > 0 && modules <= 4096) {
+		opts.autobaud_modules = modules;
+		return true;
+	} else {
+		fprintf(stderr,
+				"%s: error: '%s' is an invalid number of modules, "
+				"please specify a positive integer less or equal to 4096\n",
+				tool_name,
+				value);
+		return false;
+	}
+}
+
+static bool parse_brightness(protocol::options& opts, const char* value, const char* tool_name) {
+	intmax_t level = strtoimax(value, NULL, 10);
+	if (strlen(value) > 0 && level >= 0 && level <= 7) {
+		opts.brightness = level;
+		return true;
+	} else {
+		fprintf(stderr,
+				"%s: error: '%s' is an invalid brightness, "
+				"please specify an unsigned integer less or equal to 7\n",
+				tool_name,
+				value);
+		return false;
+	}
+}
+
+static bool parse_persist(protocol::options& opts, const char* value, const char* tool_name) {
+	if (strcmp(value, "on") == 0) {
+		opts.store = (opts.store & ~protocol::store::no_persist) | protocol::store::persist;
+	} else if (strcmp(value, "off") == 0) {
+		opts.store = (opts.store & ~protocol::store::persist) | protocol::store::no_persist;
+	} else {
+		fprintf(stderr,
+				"%s: error: '%s' is an invalid persistence, please specify on or off\n",
+				tool_name,
+				value);
+		return false;
+	}
+	return true;
+}
+
+static bool parse_framebuffer(protocol::options& opts, const char* value, const char* tool_name) {
+	const char* separator = strchr(value, ':');
+	size_t name_length = separator ? (size_t)(separator - value) : strlen(value);
+	if (name_length == 0
+	|| name_length > framebuffer::MAX_NAME_LENGTH
+	|| memchr(value, '/', name_length)) {
+		fprintf(stderr,
+				"%s: error: '%.*s' is an invalid framebuffer name, "
+				"please specify up to %zu characters other than '/'\n",
+				tool_name,
+				(int)name_length,
+				value,
+				framebuffer::MAX_NAME_LENGTH);
+		return false;
+	}
+
+	intmax_t modules = 0;
+	if (separator) {
+		char* end;
+		modules = strtoimax(separator + 1, &end, 10);
+		if (end == separator + 1 || *end) modules = 0;
+	}
+	if (modules <= 0 || modules > framebuffer::MAX_MODULES) {
+		fprintf(stderr,
+				"%s: error: '%s' is an invalid number of modules, "
+				"please specify a positive integer less or equal to %d\n",
+				tool_name,
+				separator ? separator + 1 : "",
+				framebuffer::MAX_MODULES);
+		return false;
+	}
+
+	static char name[framebuffer::MAX_NAME_LENGTH + 1];
+	memcpy(name, value, name_length);
+	name[name_length] = 0;
+	opts.framebuffer_name = name;
+	opts.framebuffer_modules = modules;
+	return true;
+}
+
+static bool parse_effect(protocol::options& opts, const char* value, const char* tool_name) {
+	static const struct {
+		const char* name;
+		char attribute;
+	} effects[] = {
+		{ "steady", protocol::attribute::steady },
+		{ "blink", protocol::attribute::blink },
+		{ "pulse", protocol::attribute::pulse },
+		{ "fade", protocol::attribute::fade }
+	};
+
+	const char* separator = strchr(value, ':');
+	size_t name_length = separator ? (size_t)(separator - value) : strlen(value);
+	intmax_t rate = 1;
+	if (separator) {
+		char* end;
+		rate = strtoimax(separator + 1, &end, 10);
+		if (end == separator + 1 || *end || rate < 0 || rate > protocol::attribute::max_rate) {
+			fprintf(stderr,
+					"%s: error: '%s' is an invalid effect rate, "
+					"please specify an unsigned integer less or equal to %d\n",
+					tool_name,
+					separator + 1,
+					protocol::attribute::max_rate);
+			return false;
+		}
+	}
+
+	for (const auto& effect : effects) {
+		if (strlen(effect.name) == name_length
+		&& strncmp(effect.name, value, name_length) == 0) {
+			opts.attribute = effect.attribute | rate << protocol::attribute::rate_shift;
+			return true;
+		}
+	}
+
+	fprintf(stderr,
+			"%s: error: '%s' is an invalid effect, "
+			"please specify steady, blink, pulse or fade\n",
+			tool_name,
+			value);
+	return false;
+}
+
 static bool parse_arguments(
-		serial::port& port,
+		serial::port& device,
+		preview::terminal& terminal,
 		protocol::options& protocol_options,
 		int argc,
 		char* argv[]) {
-	static const char* short_options = "f:hrs:t:Vw:";
+	static const char* short_options = "a:b:Cce:F:f:g:hkMmo:P:p:qrSs:t:TVw:y";
 	static struct option long_options[] = {
+		{ "autobaud", required_argument, NULL, 'a' },
+		{ "brightness", required_argument, NULL, 'b' },
+		{ "calibrate", no_argument, NULL, 'C' },
+		{ "command", no_argument, NULL, 'c' },
+		{ "effect", required_argument, NULL, 'e' },
+		{ "framebuffer", required_argument, NULL, 'F' },
 		{ "framing", required_argument, NULL, 'f' },
+		{ "gap", required_argument, NULL, 'g' },
 		{ "help", no_argument, NULL, 'h' },
+		{ "check", no_argument, NULL, 'k' },
+		{ "monitor", no_argument, NULL, 'M' },
+		{ "marquee", no_argument, NULL, 'm' },
+		{ "offset", required_argument, NULL, 'o' },
+		{ "persist", required_argument, NULL, 'p' },
+		{ "preview", required_argument, NULL, 'P' },
+		{ "query", no_argument, NULL, 'q' },
 		{ "raw", no_argument, NULL, 'r' },
+		{ "splash", no_argument, NULL, 'S' },
 		{ "speed", required_argument, NULL, 's' },
+		{ "telemetry", no_argument, NULL, 'T' },
 		{ "timing", required_argument, NULL, 'w' },
 		{ "version", no_argument, NULL, 'V' },
 		{ "window", required_argument, NULL, 'w' },
+		{ "sync", no_argument, NULL, 'y' },
 		{ NULL, 0, NULL, 0 }
 	};
 
 	const char* tool_name = argv[0];
+	const char* preview_modules = NULL;
 	int opt;
 
 	serial::options port_options;
 
 	while ((opt = getopt_long(argc, argv, short_options, long_options, NULL)) != -1) {
 		switch (opt) {
+			case 'a':	// --autobaud
+				if ( ! parse_autobaud(protocol_options, optarg, tool_name)) return false;
+				break;
+			case 'b':	// --brightness
+				if ( ! parse_brightness(protocol_options, optarg, tool_name)) return false;
+				break;
+			case 'C':	// --calibrate
+				protocol_options.calibrate = true;
+				break;
+			case 'c':	// --command
+				protocol_options.command = true;
+				break;
+			case 'e':	// --effect
+				if ( ! parse_effect(protocol_options, optarg, tool_name)) return false;
+				break;
+			case 'F':	// --framebuffer
+				if ( ! parse_framebuffer(protocol_options, optarg, tool_name)) return false;
+				break;
 			case 'f':	// --framing
 				if ( ! parse_framing(port_options, optarg, tool_name)) return false;
 				break;
+			case 'g':	// --gap
+				if ( ! parse_gap(protocol_options, optarg, tool_name)) return false;
+				break;
 			case 'h':	// --help
 				print_usage(tool_name, 1);
 				return false;
+			case 'k':	// --check
+				protocol_options.check = true;
+				break;
+			case 'M':	// --monitor
+				protocol_options.monitor = true;
+				break;
+			case 'm':	// --marquee
+				protocol_options.marquee = true;
+				break;
+			case 'o':	// --offset
+				if ( ! parse_offset(protocol_options, optarg, tool_name)) return false;
+				break;
+			case 'P':	// --preview
+				preview_modules = optarg;
+				break;
+			case 'p':	// --persist
+				if ( ! parse_persist(protocol_options, optarg, tool_name)) return false;
+				break;
+			case 'q':	// --query
+				protocol_options.query = true;
+				break;
 			case 'r':	// --raw
 				protocol_options.raw = true;
 				break;
+			case 'S':	// --splash
+				protocol_options.store |= protocol::store::splash;
+				break;
 			case 's':	// --speed
 				if ( ! parse_speed(port_options, optarg, tool_name)) return false;
 				break;
 			case 't':	// --timing
 				if ( ! parse_animation_timing(protocol_options, optarg, tool_name)) return false;
 				break;
+			case 'T':	// --telemetry
+				protocol_options.query = true;
+				protocol_options.telemetry = true;
+				break;
 			case 'V':	// --version
 				print_version(tool_name);
 				return false;
 			case 'w':	// --window
 				if ( ! parse_animation_window(protocol_options, optarg, tool_name)) return false;
 				break;
+			case 'y':	// --sync
+				protocol_options.sync = true;
+				break;
 			default:
 				return false;
 		}
 	}
 
+	if ( ! protocol_options.command
+	&& (protocol_options.offset
+		|| protocol_options.brightness >= 0
+		|| protocol_options.check
+		|| protocol_options.query
+		|| protocol_options.marquee
+		|| protocol_options.store
+		|| protocol_options.calibrate
+		|| protocol_options.monitor)) {
+		fprintf(stderr,
+				"%s: error: --offset, --brightness, --check, --query, --marquee, --splash,\n"
+				"--persist, --calibrate and --monitor require --command\n",
+				tool_name);
+		return false;
+	}
+
+	// the settings are stored once, not at each animation frame
+	if (protocol_options.store
+	&& (protocol_options.marquee || protocol_options.animation_window)) {
+		fprintf(stderr,
+				"%s: error: --splash and --persist cannot be combined with --marquee or --window\n",
+				tool_name);
+		return false;
+	}
+
+	// the echo of each message ends with the CHECK of the last module
+	if (protocol_options.monitor && ! protocol_options.check) {
+		fprintf(stderr,
+				"%s: error: --monitor requires --check\n",
+				tool_name);
+		return false;
+	}
+
+	if (protocol_options.marquee
+	&& (protocol_options.offset || protocol_options.check)) {
+		fprintf(stderr,
+				"%s: error: --marquee cannot be combined with --offset or --check\n",
+				tool_name);
+		return false;
+	}
+
+	// the frames come from the producers, not from the text or an animation
+	if (protocol_options.framebuffer_name
+	&& (protocol_options.marquee || protocol_options.animation_window || protocol_options.store)) {
+		fprintf(stderr,
+				"%s: error: --framebuffer cannot be combined with --marquee, --window,\n"
+				"--splash or --persist\n",
+				tool_name);
+		return false;
+	}
+
+	// the modules are decoded once the options of the protocol are known
+	if (preview_modules) {
+		if ( ! parse_preview(terminal, protocol_options, preview_modules, tool_name)) return false;
+
+		// nothing comes back from the terminal, and it takes each message at once
+		if (protocol_options.query
+		|| protocol_options.calibrate
+		|| protocol_options.monitor
+		|| protocol_options.autobaud_modules) {
+			fprintf(stderr,
+					"%s: error: --preview cannot be combined with --query, --calibrate,\n"
+					"--monitor or --autobaud\n",
+					tool_name);
+			return false;
+		}
+		protocol_options.end_of_message_ms = 0;
+	}
+
 	argc -= optind;
 	argv += optind;
 
-	if (argc == 2) {
-		port.set_path(argv[0]);
+	// the preview takes the place of the serial device
+	int devices = preview_modules ? 0 : 1;
+	serial::port& port = preview_modules ? terminal : device;
+
+	if (argc == devices && protocol_options.framebuffer_name) {
+		if (devices) port.set_path(argv[0]);
+		port.set_options(port_options);
+		return true;
+	} else if (protocol_options.framebuffer_name) {
+		print_usage(tool_name, 0);
+		fprintf(stderr,
+				"%s: error: %s\n",
+				tool_name,
+				argc > devices ? "text_string is not allowed with --framebuffer"
+				: "the following arguments are required: serial_device");
+		return false;
+	} else if (argc == devices + 1
+	|| (argc == devices
+		&& (protocol_options.query
+			|| protocol_options.calibrate
+			|| protocol_options.autobaud_modules))) {
+		if (devices) port.set_path(argv[0]);
 		port.set_options(port_options);
 
-		protocol_options.input_text = argv[1];
+		protocol_options.input_text = argc > devices ? argv[devices] : NULL;
 
 		return true;
 	} else {
@@ -252,7 +635,7 @@ static bool parse_arguments(
 		fprintf(stderr,
 				"%s: error: the following arguments are required: %s\n",
 				tool_name,
-				argc == 1 ? "text_string" : "serial_device");
+				argc == devices ? "text_string" : "serial_device");
 		return false;
 	}
 }
@@ -260,22 +643,55 @@ static bool parse_arguments(
 /* --------------------------------------------------------------------- */
 /* driver (main) */
 
+static volatile sig_atomic_t stopped = 0;
+
+static void stop(int) {
+	stopped = 1;
+}
+
+static bool stream(serial::port& port, const protocol::options& options) {
+	framebuffer::shared fb;
+	if ( ! fb.create(options.framebuffer_name, options.framebuffer_modules)) return false;
+
+	// the doorbell wait is interrupted, so that the driver stops at once
+	struct sigaction action = {};
+	action.sa_handler = stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	printf("Sharing framebuffer %s of %d modules\n",
+			options.framebuffer_name,
+			options.framebuffer_modules);
+	return protocol::stream(port, fb, options, stopped);
+}
+
 int main(int argc, char * argv[]) {
 	const char* tool_name = argv[0];
 
-	serial::port port;
+	serial::port device;
+	preview::terminal terminal;
 	protocol::options options;
+	int status = 0;
 
-	if (parse_arguments(port, options, argc, argv)) {
+	if (parse_arguments(device, terminal, options, argc, argv)) {
+		serial::port& port = terminal.get_modules() ? terminal : device;
 		if (port.open()) {
 			print_version(tool_name);
 			printf("Connected to %s\n", port.get_path());
 
-			protocol::send(port, options);
+			// each step stops the driver with an error if it fails
+			bool done = ( ! options.autobaud_modules || protocol::autobaud(port, options))
+				&& ( ! options.calibrate || protocol::calibrate(port, options))
+				&& ( ! options.input_text || protocol::send(port, options))
+				&& ( ! options.framebuffer_name || stream(port, options))
+				&& ( ! options.query || protocol::query(port, options));
+			if ( ! done) status = 1;
 
 			port.close();
+		} else {
+			status = 1;
 		}
 	}
 
-	return 0;
+	return status;
 }
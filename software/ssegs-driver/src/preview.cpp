@@ -0,0 +1,341 @@
+/* 
+ * File:   preview.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include "display.hpp"
+#include "preview.h"
+#include "protocol.h"
+
+/* --------------------------------------------------------------------- */
+
+constexpr char SYNC_FIELD = 0x55;
+
+/**
+ * The width of a module in the terminal, the decimal point included.
+ */
+constexpr int CELL_COLUMNS = 4;
+constexpr int CELL_ROWS = 3;
+
+/**
+ * The brightness levels drawn dim.
+ */
+constexpr int DIM_LEVEL = 3;
+
+/**
+ * The attribute of the glyphs given as segment maps (SEGS).
+ */
+constexpr char RAW_ATTRIBUTE = -1;
+
+static inline bool is_command(uint8_t code) {
+	return protocol::code::skip <= code && code <= protocol::code::sync;
+}
+
+static inline bool is_attribute(uint8_t code) {
+	return (code & 0xF0) == protocol::attribute::steady;
+}
+
+static int operands(uint8_t op) {
+	switch (op) {
+		case protocol::code::fill:
+		case protocol::code::write:
+		case protocol::code::segs:
+			return 2;
+		default:
+			return 1;
+	}
+}
+
+/*
+ * Draws one row of the segments of a glyph:
+ *  _
+ * |_|
+ * |_|.
+ */
+static void draw_row(std::string& output, uint8_t segs, int row) {
+	using namespace display::segment;
+
+	switch (row) {
+		case 0:
+			output += ' ';
+			output += segs & a ? '_' : ' ';
+			output += "  ";
+			break;
+		case 1:
+			output += segs & f ? '|' : ' ';
+			output += segs & g ? '_' : ' ';
+			output += segs & b ? '|' : ' ';
+			output += ' ';
+			break;
+		default:
+			output += segs & e ? '|' : ' ';
+			output += segs & d ? '_' : ' ';
+			output += segs & c ? '|' : ' ';
+			output += segs & dp ? '.' : ' ';
+			break;
+	}
+}
+
+/*
+ * The lit segments are red, bright or dim as the modules,
+ * blinking with the blink and pulse effects.
+ */
+static void draw_style(std::string& output, char attr, int brightness) {
+	char effect = attr == RAW_ATTRIBUTE ? 0 : attr & ~(protocol::attribute::max_rate << protocol::attribute::rate_shift);
+	output += "\x1b[0;31";
+	output += brightness <= DIM_LEVEL ? ";2" : ";1";
+	if (effect == protocol::attribute::blink || effect == protocol::attribute::pulse) output += ";5";
+	output += 'm';
+}
+
+namespace preview {
+
+	terminal::terminal() {
+		modules = 0;
+		command = false;
+		opened = false;
+		drawn = false;
+		after_break = false;
+		marquee = false;
+		brightness = display::MAX_BRIGHTNESS;
+		shown_brightness = brightness;
+		set_path("terminal");
+	}
+
+	terminal::~terminal() {
+		close();
+	}
+
+	void terminal::set_chain(int modules, bool command) {
+		this->modules = modules;
+		this->command = command;
+		committed.assign(modules, cell { 0, 0 });
+		staged.assign(modules, cell { 0, 0 });
+		written.assign(modules, false);
+		shown = committed;
+	}
+
+	bool terminal::open() {
+		opened = true;
+		drawn = false;
+		return true;
+	}
+
+	void terminal::close() {
+		if (drawn) {
+			fputs("\x1b[0m\x1b[?25h", stdout);
+			fflush(stdout);
+			drawn = false;
+		}
+		opened = false;
+	}
+
+
+	ssize_t terminal::read(const serial::buffer&) {
+		return 0;
+	}
+
+	ssize_t terminal::write(const serial::buffer& buffer, size_t size) {
+		const uint8_t* data = ((const uint8_t*)buffer.ptr) + buffer.offset;
+		size_t length = size;
+		if (after_break && length && data[0] == (uint8_t)SYNC_FIELD) {
+			++data;
+			--length;
+		}
+		after_break = false;
+
+		if (command) {
+			decode_commands(data, length);
+		} else {
+			decode_frame(data, length);
+		}
+		render();
+		return size;
+	}
+
+	bool terminal::drain() {
+		return fflush(stdout) == 0;
+	}
+
+	bool terminal::send_break(int) {
+		after_break = true;
+		return true;
+	}
+
+	void terminal::stage(int module, uint8_t segs, char attr) {
+		if (0 <= module && module < modules) {
+			staged[module] = cell { segs, attr };
+			written[module] = true;
+		}
+	}
+
+	/*
+	 * Decodes a message as the chain does in store-and-forward mode:
+	 * each glyph goes to the next module not yet written or skipped,
+	 * and the glyphs are committed by a valid CHECK or by the end of
+	 * a message which is not truncated.
+	 */
+	void terminal::decode_commands(const uint8_t* data, size_t size) {
+		int next = 0;
+		char attr = 0;
+		uint8_t op = 0;
+		int argc = 0;
+		uint8_t args[2];
+		int raw = 0;
+		uint8_t crc = 0;
+		uint8_t check_crc = 0;
+		int staged_brightness = -1;
+		int staged_marquee = -1;
+
+		auto commit = [&](bool valid) {
+			for (int i = 0; i < modules; ++i) {
+				if (valid && written[i]) committed[i] = staged[i];
+				written[i] = false;
+			}
+			if (valid && staged_brightness >= 0) brightness = staged_brightness;
+			if (valid && staged_marquee >= 0) marquee = staged_marquee;
+			staged_brightness = -1;
+			staged_marquee = -1;
+		};
+
+		for (size_t i = 0; i < size; ++i) {
+			uint8_t unit = data[i];
+			uint8_t previous_crc = crc;
+			crc = protocol::crc8(crc, (const char*)&unit, 1);
+
+			if (raw) {
+				--raw;
+			} else if (op) {
+				args[argc++] = unit;
+				if (argc < operands(op)) continue;
+				switch (op) {
+					case protocol::code::skip:
+						next += args[0];
+						break;
+					case protocol::code::fill:
+						for (int n = 0; n < args[0]; ++n) {
+							stage(next++, display::char_to_segs(args[1]), attr);
+						}
+						break;
+					case protocol::code::write:
+						stage(args[0], display::char_to_segs(args[1]), attr);
+						break;
+					case protocol::code::segs:
+						stage(args[0], args[1], RAW_ATTRIBUTE);
+						break;
+					case protocol::code::bright:
+						staged_brightness = args[0];
+						break;
+					case protocol::code::check:
+						commit(args[0] == check_crc);
+						crc = 0;
+						break;
+					case protocol::code::marquee:
+						staged_marquee = args[0] != 0;
+						break;
+					case protocol::code::report:
+						raw = args[0];
+						break;
+				}
+				op = 0;
+			} else if (is_command(unit)) {
+				op = unit;
+				argc = 0;
+				check_crc = previous_crc;
+			} else if (is_attribute(unit)) {
+				attr = unit;
+			} else if (staged_marquee >= 0 ? staged_marquee : marquee) {
+				// each module forwards its glyph to the next one as a character
+				for (int n = modules - 1; n > 0; --n) {
+					const cell& from = written[n - 1] ? staged[n - 1] : committed[n - 1];
+					stage(n, from.segs, attr);
+				}
+				stage(0, display::char_to_segs(unit), attr);
+			} else {
+				stage(next++, display::char_to_segs(unit), attr);
+			}
+		}
+
+		// a message truncated in the middle of a command lost some units
+		commit( ! op && ! raw);
+	}
+
+	/*
+	 * Decodes a frame as the chain does in mirror mode: each module takes
+	 * the first unit that reaches it, after an attribute prefix if any,
+	 * and mirrors the rest to the next module. A module taking the sync
+	 * code keeps its glyph, and any unit after a prefix is a character.
+	 */
+	void terminal::decode_frame(const uint8_t* data, size_t size) {
+		int next = 0;
+		char attr = 0;
+		for (size_t i = 0; i < size && next < modules; ++i) {
+			uint8_t unit = data[i];
+			if ( ! attr && is_attribute(unit)) {
+				attr = unit;
+				continue;
+			}
+			if (unit != (uint8_t)protocol::code::sync) {
+				committed[next] = cell { display::char_to_segs(unit), attr };
+			}
+			++next;
+			attr = 0;
+		}
+	}
+
+	/*
+	 * Redraws the modules whose glyph changed, in a single write:
+	 * the cursor rests below the chain between two frames.
+	 * The first frame makes room for the chain below the messages
+	 * printed so far, and draws all the modules.
+	 */
+	void terminal::render() {
+		if ( ! opened) return;
+
+		output.clear();
+		bool all = ! drawn || brightness != shown_brightness;
+		if ( ! drawn) output += "\x1b[?25l\n\n\n";
+		drawn = true;
+		shown_brightness = brightness;
+
+		output += "\x1b[3A";
+		for (int row = 0; row < CELL_ROWS; ++row) {
+			for (int i = 0; i < modules; ++i) {
+				if ( ! all && ! (committed[i] != shown[i])) continue;
+				output += "\x1b[" + std::to_string(i * CELL_COLUMNS + 1) + "G";
+				draw_style(output, committed[i].attr, brightness);
+				draw_row(output, committed[i].segs, row);
+			}
+			output += "\x1b[0m\x1b[1B";
+		}
+		output += '\r';
+		shown = committed;
+
+		fwrite(output.data(), 1, output.size(), stdout);
+		fflush(stdout);
+	}
+
+}
@@ -0,0 +1,111 @@
+/* 
+ * File:   preview.h
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PREVIEW_H_INCLUDED
+#define PREVIEW_H_INCLUDED
+
+/* --------------------------------------------------------------------- */
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "serial.h"
+
+/* --------------------------------------------------------------------- */
+
+namespace preview {
+
+	/**
+	 * Renders what a chain of modules would display as 7-segment art
+	 * in the terminal, in place of the serial device.
+	 * The messages written are decoded as the modules do, each write
+	 * being a message; only the modules whose glyph changed are redrawn.
+	 * There is no loopback: nothing is ever read back.
+	 * The chain is drawn on a single row, 4 columns per module.
+	 */
+	class terminal : public serial::port {
+		struct cell {
+			uint8_t segs;
+			char    attr;
+
+			inline bool operator!=(const cell& other) const {
+				return segs != other.segs || attr != other.attr;
+			}
+		};
+
+		int               modules;  // 0 if the preview is not used
+		bool              command;  // the modules are in store-and-forward mode
+		bool              opened;
+		bool              drawn;    // the chain was drawn since it was opened
+		bool              after_break; // the next unit is the sync field of the auto-baud
+		bool              marquee;
+		int               brightness;
+		int               shown_brightness;
+		std::vector<cell> shown;     // the glyphs drawn in the terminal
+		std::vector<cell> committed; // the glyphs of the modules
+		std::vector<cell> staged;    // the glyphs written by the current message
+		std::vector<bool> written;
+		std::string       output;
+
+		void stage(int module, uint8_t segs, char attr);
+		void decode_commands(const uint8_t* data, size_t size);
+		void decode_frame(const uint8_t* data, size_t size);
+		void render();
+
+	public:
+		terminal();
+		~terminal();
+
+		void set_chain(int modules, bool command);
+
+		inline int get_modules() const {
+			return modules;
+		}
+
+		/**
+		 * Gets the segments shown by a module, 0 if out of the chain.
+		 */
+		inline uint8_t get_segments(int module) const {
+			return 0 <= module && module < modules ? committed[module].segs : 0;
+		}
+
+		bool open() override;
+		void close() override;
+
+		ssize_t read(const serial::buffer& buffer) override;
+		ssize_t write(const serial::buffer& buffer, size_t size) override;
+
+		bool drain() override;
+		bool send_break(int ms) override;
+	};
+
+}
+
+/* --------------------------------------------------------------------- */
+
+#endif /* PREVIEW_H_INCLUDED */
@@ -25,6 +25,8 @@
  */
 
 #include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -37,7 +39,47 @@
 
 constexpr size_t BUFFER_MAXSIZE = 4096;
 
-static char output_data[BUFFER_MAXSIZE];
+/**
+ * The min length of a run of equal characters encoded as a FILL command.
+ */
+constexpr int MIN_FILL_RUN = 4;
+
+/**
+ * The min length of a run of unchanged characters encoded as a SKIP command.
+ */
+constexpr int MIN_SKIP_RUN = 3;
+
+/**
+ * The max time to wait for the reports of a query, in milliseconds.
+ */
+constexpr long QUERY_TIMEOUT_MS = 1000;
+/**
+ * The max time to sleep on the doorbell of a framebuffer, in milliseconds.
+ */
+constexpr long STREAM_WAIT_MS = 100;
+/**
+ * The poll interval of the loopback while timing the echoes, in milliseconds.
+ */
+constexpr long ECHO_POLL_MS = 1;
+
+/**
+ * The number of probes sent to measure each quantity of the calibration.
+ */
+constexpr int CALIBRATION_PROBES = 4;
+
+/**
+ * The gaps between two messages tried by the calibration, in milliseconds.
+ */
+constexpr int GAP_STEP_MS = 5;
+constexpr int MAX_GAP_MS = 200;
+constexpr int GAP_MARGIN_MS = 5; // added to the min gap found
+constexpr int BREAK_MS = 2; // longer than 13 bits at 9600 bps or more
+constexpr char SYNC_FIELD = 0x55;
+
+// each thread encodes its messages in its own buffers (@see ssegs::client)
+static thread_local char output_data[BUFFER_MAXSIZE];
+static thread_local char previous_data[BUFFER_MAXSIZE];
+static thread_local char command_data[3 * BUFFER_MAXSIZE + 8];
 
 static void copy_text(serial::buffer& output, const protocol::options& opts) {
 	size_t length = 0;
@@ -114,6 +156,157 @@ static void process_text(serial::buffer& output, const protocol::options& opts)
 	output.size = length;
 }
 
+static inline bool is_command(char code) {
+	return (protocol::code::skip <= code && code <= protocol::code::sync)
+		|| (code & 0xF0) == protocol::attribute::steady;
+}
+
+static size_t put_skip(size_t length, int count) {
+	while (count > 0) {
+		int n = count < 255 ? count : 255;
+		command_data[length++] = protocol::code::skip;
+		command_data[length++] = (char)n;
+		count -= n;
+	}
+	return length;
+}
+
+static size_t put_fill(size_t length, int count, char code) {
+	while (count > 0) {
+		int n = count < 255 ? count : 255;
+		command_data[length++] = protocol::code::fill;
+		command_data[length++] = (char)n;
+		command_data[length++] = code;
+		count -= n;
+	}
+	return length;
+}
+
+/*
+ * Encodes a frame with the command set of the store-and-forward mode.
+ * Runs of equal characters are encoded with FILL,
+ * runs of characters unchanged since the previous frame with SKIP.
+ * Character codes which collide with command or attribute codes
+ * are sent with FILL.
+ * The attribute, if any, applies to all the characters of the message.
+ * The first message of a run, without a previous frame, stops the marquee
+ * mode, which would shift in its characters instead of writing them,
+ * and begins with the timer sync if requested.
+ * The settings to store follow the glyphs, so that the modules store them
+ * once committed. When checked, the message ends with a CHECK of its CRC-8.
+ */
+static void encode_commands(
+		serial::buffer& output,
+		const serial::buffer& frame,
+		const char* previous,
+		int brightness,
+		const protocol::options& opts) {
+	const char* in = ((const char*)frame.ptr) + frame.offset;
+	size_t length = 0;
+	int skip = opts.offset;
+
+	if (!previous) {
+		// the sync is forwarded first, when the TX queues are empty
+		if (opts.sync) {
+			command_data[length++] = protocol::code::sync;
+			command_data[length++] = 0;
+		}
+		command_data[length++] = protocol::code::marquee;
+		command_data[length++] = 0;
+	}
+
+	if (brightness >= 0) {
+		command_data[length++] = protocol::code::bright;
+		command_data[length++] = (char)brightness;
+	}
+
+	if (opts.attribute) {
+		command_data[length++] = opts.attribute;
+	}
+
+	int i = 0;
+	while (i < frame.size) {
+		if (previous && in[i] == previous[i]) {
+			int run = 1;
+			while (i + run < frame.size && in[i + run] == previous[i + run]) ++run;
+			if (i + run == frame.size) break; // trailing modules are left unchanged
+			if (run >= MIN_SKIP_RUN) {
+				skip += run;
+				i += run;
+				continue;
+			}
+		}
+
+		int run = 1;
+		while (i + run < frame.size && in[i + run] == in[i]) ++run;
+
+		length = put_skip(length, skip);
+		skip = 0;
+
+		if (run >= MIN_FILL_RUN) {
+			length = put_fill(length, run, in[i]);
+			i += run;
+		} else if (is_command(in[i])) {
+			length = put_fill(length, 1, in[i]);
+			++i;
+		} else {
+			command_data[length++] = in[i++];
+		}
+	}
+
+	// the modules store the settings once the glyphs are committed
+	if (opts.store) {
+		command_data[length++] = protocol::code::store;
+		command_data[length++] = opts.store;
+	}
+
+	if (opts.check) {
+		uint8_t crc = protocol::crc8(0, command_data, length);
+		command_data[length++] = protocol::code::check;
+		command_data[length++] = (char)crc;
+	}
+
+	output.ptr = command_data;
+	output.offset = 0;
+	output.size = length;
+}
+
+/*
+ * Encodes a frame for modules in mirror mode.
+ * Each character code is prefixed with the attribute code, if any.
+ * When synced, the message ends with the sync code:
+ * the modules sync their timers at the end of the message.
+ */
+static void encode_frame(
+		serial::buffer& output,
+		const serial::buffer& frame,
+		char attribute,
+		bool sync) {
+	const char* in = ((const char*)frame.ptr) + frame.offset;
+	size_t length = 0;
+
+	for (int i = 0; i < frame.size; ++i) {
+		if (attribute) command_data[length++] = attribute;
+		command_data[length++] = in[i];
+	}
+
+	if (sync) {
+		command_data[length++] = protocol::code::sync;
+	}
+
+	output.ptr = command_data;
+	output.offset = 0;
+	output.size = length;
+}
+
+static bool write_frame(serial::port& port, const serial::buffer& buffer) {
+	if (port.write(buffer, buffer.size) < buffer.size) {
+		perror("Couldn't write data to serial device");
+		return false;
+	}
+	return true;
+}
+
 static int sleep_millis(long ms) {
 	if (ms < 0) {
 		errno = EINVAL;
@@ -133,13 +326,325 @@ static int sleep_millis(long ms) {
 	return res;
 }
 
+static long now_us() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+/*
+ * The time for a message to reach the last of the modules:
+ * in store-and-forward mode, each module delays it by one unit,
+ * or by the delay measured by the calibration.
+ */
+static long message_ms(serial::options& serial_options, const protocol::options& opts, int size, int modules) {
+	if ( ! opts.command) return serial_options.ms_per_message(size);
+	if (opts.modules) modules = opts.modules;
+	if ( ! opts.hop_latency_us) return serial_options.ms_per_message(size + modules);
+	return serial_options.ms_per_message(size) + (modules * opts.hop_latency_us + 999) / 1000;
+}
+
+/*
+ * Decodes the messages echoed by the last module of a looped back chain.
+ * Each module ends the units it forwards with a CHECK of their CRC-8,
+ * inverted if the module dropped the message:
+ * the last CHECK tells whether the whole chain committed the message,
+ * while a CRC which matches neither way was corrupted by the loopback.
+ */
+static thread_local struct {
+	uint8_t crc;    // CRC of the units echoed since the last CHECK
+	char op;        // the command being decoded, 0 if none
+	int argc;       // the number of operands received
+	int raw;        // the number of REPORT units left
+	long last_us;   // the time of the last unit echoed
+
+	long sent;      // the messages sent with a CHECK
+	long committed;
+	long dropped;
+	long corrupted;
+	long units;     // the units echoed other than CHECKs
+
+	inline long echoed() const {
+		return committed + dropped + corrupted;
+	}
+
+	static int operands(char op) {
+		switch (op) {
+			case protocol::code::fill:
+			case protocol::code::write:
+			case protocol::code::segs:
+				return 2;
+			default:
+				return 1;
+		}
+	}
+
+	inline void begin() {
+		crc = 0;
+		op = 0;
+		raw = 0;
+	}
+
+	inline void append(uint8_t unit) {
+		crc = protocol::crc8(crc, (const char*)&unit, 1);
+		++units;
+	}
+
+	void receive(uint8_t unit) {
+		if (raw) {
+			--raw;
+			append(unit);
+		} else if (op == protocol::code::check) {
+			if (unit == crc) ++committed;
+			else if (unit == (uint8_t)~crc) ++dropped;
+			else ++corrupted;
+			begin();
+		} else if (op) {
+			append(unit);
+			if (op == protocol::code::report) raw = unit;
+			if (op == protocol::code::report || ++argc == operands(op)) op = 0;
+		} else if (unit == protocol::code::check) {
+			op = unit;
+		} else {
+			if (protocol::code::skip <= unit && unit <= protocol::code::sync) {
+				op = unit;
+				argc = 0;
+			}
+			append(unit);
+		}
+	}
+} echo;
+
+/*
+ * Decodes the units echoed so far, without waiting.
+ * A pause of half the end of message gap begins a new message,
+ * so that a message truncated before its CHECK does not spoil the next one.
+ * @return false on error, true otherwise.
+ */
+static bool receive_echo(serial::port& port, const protocol::options& opts) {
+	uint8_t data[256];
+	serial::buffer input = { data, 0, sizeof(data) };
+	ssize_t count;
+	while ((count = port.read(input)) > 0) {
+		long now = now_us();
+		if (now - echo.last_us > opts.end_of_message_ms * 500L) echo.begin();
+		echo.last_us = now;
+		for (ssize_t i = 0; i < count; ++i) echo.receive(data[i]);
+	}
+	return count == 0;
+}
+
+/*
+ * Waits until the CHECKs of all the messages sent are echoed.
+ * @return the time since since_us in microseconds, -1 on timeout or error.
+ */
+static long wait_echo(serial::port& port, const protocol::options& opts, long since_us) {
+	for (;;) {
+		if ( ! receive_echo(port, opts)) return -1;
+		long elapsed_us = now_us() - since_us;
+		if (echo.echoed() >= echo.sent) return elapsed_us;
+		if (elapsed_us > QUERY_TIMEOUT_MS * 1000) return -1;
+		sleep_millis(ECHO_POLL_MS);
+	}
+}
+
+static void monitor_sent(serial::port& port, const protocol::options& opts) {
+	if (opts.monitor) {
+		++echo.sent;
+		receive_echo(port, opts);
+	}
+}
+
+static void monitor_end(serial::port& port, const protocol::options& opts) {
+	if (opts.monitor) {
+		wait_echo(port, opts, now_us());
+		printf("%ld messages: %ld committed, %ld dropped by the modules, "
+				"%ld corrupted in the loopback, %ld lost\n",
+				echo.sent,
+				echo.committed,
+				echo.dropped,
+				echo.corrupted,
+				echo.sent - echo.echoed());
+	}
+}
+
+/*
+ * Sends a message which each module skips, then checks:
+ * the echo of a probe merged with the previous message carries the SKIP,
+ * since the modules skip once per message.
+ * @return the number of units sent, -1 on error.
+ */
+static int send_probe(serial::port& port, const protocol::options& opts) {
+	size_t length = put_skip(0, opts.modules);
+	uint8_t crc = protocol::crc8(0, command_data, length);
+	command_data[length++] = protocol::code::check;
+	command_data[length++] = (char)crc;
+
+	serial::buffer probe = { command_data, 0, (int)length };
+	++echo.sent;
+	return write_frame(port, probe) ? (int)length : -1;
+}
+
+/*
+ * Shifts the characters of a text into the chain one at a time,
+ * last character first: the chain scrolls from its first module to its last,
+ * so the text reads in order once it is shifted in.
+ */
+static bool send_marquee(serial::port& port, const serial::buffer& text, const protocol::options& opts) {
+	auto serial_options = port.get_options();
+	const char* in = ((const char*)text.ptr) + text.offset;
+	size_t length = 0;
+
+	if (opts.sync) {
+		command_data[length++] = protocol::code::sync;
+		command_data[length++] = 0;
+	}
+	if (opts.brightness >= 0) {
+		command_data[length++] = protocol::code::bright;
+		command_data[length++] = (char)opts.brightness;
+	}
+	command_data[length++] = protocol::code::marquee;
+	command_data[length++] = 1;
+
+	for (int i = text.size - 1; i >= 0; --i) {
+		// the attribute of a message ends with it, so it is sent at every step
+		if (opts.attribute) command_data[length++] = opts.attribute;
+		command_data[length++] = is_command(in[i]) ? ' ' : in[i];
+
+		serial::buffer step = { command_data, 0, (int)length };
+		if ( ! write_frame(port, step)) return false;
+
+		long wait_ms = serial_options.ms_per_message(length);
+		if (wait_ms < opts.animation_timing_ms) wait_ms = opts.animation_timing_ms;
+		sleep_millis(wait_ms);
+		length = 0;
+	}
+	return true;
+}
+
+static inline unsigned get_word(const uint8_t* payload) {
+	return payload[0] | payload[1] << 8;
+}
+
+static void print_telemetry(int module, const uint8_t* payload) {
+	static const char* handlers[] = { "RXC", "TCA0", "MUX", "RTC" };
+
+	printf("module %d: %u%% out of IRQs, mux interval %u..%u cycles\n",
+			module,
+			payload[17],
+			get_word(payload + 18),
+			get_word(payload + 20));
+	for (int i = 0; i < 4; ++i) {
+		printf("\t%s: max %u, avg %u cycles\n",
+				handlers[i],
+				get_word(payload + 1 + 4 * i),
+				get_word(payload + 3 + 4 * i));
+	}
+}
+
+static void print_report(int module, const uint8_t* payload, int size) {
+	if (size == 5 && payload[0] == protocol::report::errors) {
+		printf("module %d: %u RX errors, %u dropped messages\n",
+				module,
+				get_word(payload + 1),
+				get_word(payload + 3));
+	} else if (size == 22 && payload[0] == protocol::report::telemetry) {
+		print_telemetry(module, payload);
+	} else {
+		printf("module %d: unknown report\n", module);
+	}
+}
+
+/*
+ * Queries a report of the given kind from each module, and prints them if requested.
+ * The reports are parsed as they arrive, until the query comes back.
+ * @return the number of modules which answered, -1 if the query did not come back.
+ */
+static int collect_reports(serial::port& port, char kind, bool print) {
+	char message[] = { protocol::code::query, kind };
+	serial::buffer buffer = { message, 0, sizeof(message) };
+	if ( ! write_frame(port, buffer)) return -1;
+
+	uint8_t data[256];
+	uint8_t payload[256];
+	serial::buffer input = { data, 0, sizeof(data) };
+	int module = 0;
+	int state = 0; // 0: code, 1: REPORT size, 2: payload, 3: QUERY kind
+	int size = 0;
+	int received = 0;
+
+	for (long waited = 0; waited < QUERY_TIMEOUT_MS; waited += 10) {
+		ssize_t count = port.read(input);
+		if (count < 0) return -1;
+		for (ssize_t i = 0; i < count; ++i) {
+			uint8_t unit = data[i];
+			switch (state) {
+				case 0:
+					if (unit == protocol::code::report) state = 1;
+					else if (unit == protocol::code::query) state = 3;
+					break;
+				case 1:
+					size = unit;
+					received = 0;
+					state = size ? 2 : 0;
+					if (!size) {
+						if (print) print_report(module, payload, 0);
+						++module;
+					}
+					break;
+				case 2:
+					payload[received++] = unit;
+					if (received == size) {
+						if (print) print_report(module, payload, size);
+						++module;
+						state = 0;
+					}
+					break;
+				case 3:
+					return module;
+			}
+		}
+		if (!count) sleep_millis(10);
+	}
+
+	return -1;
+}
+
 namespace protocol {
 
+	uint8_t crc8(uint8_t crc, const char* data, size_t size) {
+		while (size--) {
+			crc ^= (uint8_t)*data++;
+			for (int i = 0; i < 8; ++i) {
+				crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+			}
+		}
+		return crc;
+	}
+
 	options::options() {
 		input_text = NULL;
 		raw = false;
+		command = false;
+		check = false;
+		query = false;
+		telemetry = false;
+		marquee = false;
+		sync = false;
+		offset = 0;
+		brightness = -1;
+		autobaud_modules = 0;
+		attribute = 0;
+		store = 0;
 		animation_window = 0;
 		animation_timing_ms = 100;
+		framebuffer_name = NULL;
+		framebuffer_modules = 0;
+		calibrate = false;
+		monitor = false;
+		end_of_message_ms = END_OF_MESSAGE_MS;
+		hop_latency_us = 0;
+		modules = 0;
 	}
 
 	void process(serial::buffer& output, const options& opts) {
@@ -150,15 +655,19 @@ namespace protocol {
 		}
 	}
 
-	void send(serial::port& port, const options& opts) {
+	bool send(serial::port& port, const options& opts) {
 		serial::buffer buffer;
+		serial::buffer encoded;
 		protocol::process(buffer, opts);
 
-		if (buffer.size > opts.animation_window
+		if (opts.marquee) {
+			return send_marquee(port, buffer, opts);
+		} else if (buffer.size > opts.animation_window
 		&& opts.is_animated()) {
 			auto serial_options = port.get_options();
-			long wait_ms = serial_options.ms_per_message(opts.animation_window) + END_OF_MESSAGE_MS;
-			if (wait_ms < opts.animation_timing_ms) wait_ms = opts.animation_timing_ms;
+			int modules = opts.offset + opts.animation_window;
+			int brightness = opts.brightness;
+			const char* previous = NULL;
 
 			int begin = 0;
 			int end = buffer.size - opts.animation_window;
@@ -166,18 +675,175 @@ namespace protocol {
 				buffer.offset = begin;
 				buffer.size = opts.animation_window;
 
-				if (port.write(buffer, buffer.size) < buffer.size) {
-					perror("Couldn't write data to serial device");
+				long wait_ms;
+				if (opts.command) {
+					encode_commands(encoded, buffer, previous, brightness, opts);
+					if ( ! write_frame(port, encoded)) return false;
+					monitor_sent(port, opts);
+					wait_ms = message_ms(serial_options, opts, encoded.size, modules);
+					previous = output_data + begin;
+					brightness = -1;
+				} else {
+					encode_frame(encoded, buffer, opts.attribute, opts.sync && begin == 0);
+					if ( ! write_frame(port, encoded)) return false;
+					wait_ms = serial_options.ms_per_message(encoded.size);
 				}
 
+				wait_ms += opts.end_of_message_ms;
+				if (wait_ms < opts.animation_timing_ms) wait_ms = opts.animation_timing_ms;
 				sleep_millis(wait_ms);
 				++begin;
 			}
+			monitor_end(port, opts);
+		} else if (opts.command) {
+			encode_commands(encoded, buffer, NULL, opts.brightness, opts);
+			if ( ! write_frame(port, encoded)) return false;
+			monitor_sent(port, opts);
+			monitor_end(port, opts);
 		} else {
-			if (port.write(buffer, buffer.size) < buffer.size) {
-				perror("Couldn't write data to serial device");
+			encode_frame(encoded, buffer, opts.attribute, opts.sync);
+			return write_frame(port, encoded);
+		}
+		return true;
+	}
+
+	bool stream(serial::port& port, framebuffer::shared& fb, const options& opts,
+			const volatile sig_atomic_t& stopped) {
+		auto serial_options = port.get_options();
+		serial::buffer frame = { output_data, 0, fb.modules() };
+		serial::buffer encoded;
+		int modules = opts.offset + fb.modules();
+		int brightness = opts.brightness;
+		const char* previous = NULL;
+
+		while ( ! stopped) {
+			uint32_t sequence = fb.sequence();
+			fb.snapshot(output_data);
+
+			if ( ! previous || memcmp(output_data, previous, frame.size)) {
+				long wait_ms;
+				if (opts.command) {
+					encode_commands(encoded, frame, previous, brightness, opts);
+					if ( ! write_frame(port, encoded)) return false;
+					monitor_sent(port, opts);
+					wait_ms = message_ms(serial_options, opts, encoded.size, modules);
+					brightness = -1;
+				} else {
+					encode_frame(encoded, frame, opts.attribute, opts.sync && ! previous);
+					if ( ! write_frame(port, encoded)) return false;
+					wait_ms = serial_options.ms_per_message(encoded.size);
+				}
+				memcpy(previous_data, output_data, frame.size);
+				previous = previous_data;
+				sleep_millis(wait_ms + opts.end_of_message_ms);
 			}
+
+			while ( ! stopped && ! fb.wait(sequence, STREAM_WAIT_MS));
+		}
+		monitor_end(port, opts);
+		return true;
+	}
+
+	/*
+	 * The length of the chain is the number of reports to a query.
+	 * The delay of the modules is the round trip of a probe, less its own
+	 * transmission time, the max of a few probes for a safe pacing.
+	 * The min gap is the shortest one at which the modules never merge
+	 * two probes, plus a margin.
+	 */
+	bool calibrate(serial::port& port, options& opts) {
+		auto serial_options = port.get_options();
+		receive_echo(port, opts);
+		echo = {};
+
+		opts.modules = collect_reports(port, report::errors, false);
+		if (opts.modules <= 0) {
+			fprintf(stderr,
+					"No answer to the calibration: please check that the last module "
+					"is looped back to the serial device\n");
+			opts.modules = 0;
+			return false;
+		}
+		sleep_millis(opts.end_of_message_ms);
+
+		long unit_us = serial_options.bits_per_char() * 1000000L / serial_options.speed;
+		long max_us = 0;
+		for (int i = 0; i < CALIBRATION_PROBES; ++i) {
+			long since_us = now_us();
+			int size = send_probe(port, opts);
+			long round_trip_us = size < 0 ? -1 : wait_echo(port, opts, since_us);
+			if (round_trip_us < 0 || echo.units) {
+				fprintf(stderr, "The calibration probes were not echoed as sent\n");
+				return false;
+			}
+			round_trip_us -= size * unit_us;
+			if (round_trip_us > max_us) max_us = round_trip_us;
+			sleep_millis(opts.end_of_message_ms);
+		}
+
+		opts.hop_latency_us = max_us / opts.modules;
+		if (opts.hop_latency_us < unit_us) opts.hop_latency_us = unit_us;
+
+		int gap_ms = 0;
+		for (int gap = GAP_STEP_MS; gap <= MAX_GAP_MS && ! gap_ms; gap += GAP_STEP_MS) {
+			bool merged = false;
+			for (int i = 0; i < CALIBRATION_PROBES && ! merged; ++i) {
+				// the gap begins once the first probe has left the serial device
+				bool sent = send_probe(port, opts) > 0 && port.drain();
+				sleep_millis(gap);
+				if ( ! sent
+				|| send_probe(port, opts) < 0
+				|| wait_echo(port, opts, now_us()) < 0) {
+					fprintf(stderr, "The calibration probes were not echoed\n");
+					return false;
+				}
+				merged = echo.units;
+				echo.units = 0;
+				sleep_millis(MAX_GAP_MS);
+			}
+			if ( ! merged) gap_ms = gap;
+		}
+
+		if ( ! gap_ms) {
+			fprintf(stderr, "The modules merge messages %d ms apart\n", MAX_GAP_MS);
+			return false;
+		}
+		opts.end_of_message_ms = gap_ms + GAP_MARGIN_MS;
+
+		printf("Calibrated %d modules: %ld us per module, %d ms between messages\n",
+				opts.modules,
+				opts.hop_latency_us,
+				opts.end_of_message_ms);
+		echo = {};
+		return true;
+	}
+
+	bool autobaud(serial::port& port, const options& opts) {
+		char sync_field = SYNC_FIELD;
+		serial::buffer buffer = { &sync_field, 0, 1 };
+		int count = opts.command ? 1 : opts.autobaud_modules;
+		while (count--) {
+			if ( ! port.send_break(BREAK_MS)) {
+				perror("Couldn't send a break to serial device");
+				return false;
+			}
+			if ( ! write_frame(port, buffer)) return false;
+		}
+
+		// the modules change their speed and save it before the next message
+		auto serial_options = port.get_options();
+		sleep_millis(serial_options.ms_per_message(1) + opts.end_of_message_ms);
+		return true;
+	}
+
+	bool query(serial::port& port, const options& opts) {
+		if (collect_reports(port, opts.telemetry ? report::telemetry : report::errors, true) >= 0) {
+			return true;
 		}
 
+		fprintf(stderr,
+				"No answer to the query: please check that the last module "
+				"is looped back to the serial device\n");
+		return false;
 	}
 }
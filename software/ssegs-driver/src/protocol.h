@@ -29,21 +29,93 @@
 
 /* --------------------------------------------------------------------- */
 
+#include <signal.h>
 #include <stdint.h>
 
+#include "framebuffer.h"
 #include "serial.h"
 
 /* --------------------------------------------------------------------- */
 
 namespace protocol {
 
+    /**
+     * The default gap which ends a message: the protocol timeout of the modules.
+     */
     constexpr int END_OF_MESSAGE_MS = 50;
 
+    /**
+     * The command set of the display modules in store-and-forward mode.
+     * Any other message unit is a character code.
+     */
+    namespace code {
+        constexpr char skip    = 0x01; // SKIP n: leaves n modules unchanged
+        constexpr char fill    = 0x02; // FILL n c: writes c to n modules
+        constexpr char write   = 0x03; // WRITE o c: writes c to the module at offset o
+        constexpr char bright  = 0x04; // BRIGHT l: sets the brightness of all modules
+        constexpr char check   = 0x05; // CHECK crc: commits the writes if crc matches
+        constexpr char query   = 0x06; // QUERY k: each module appends a report of kind k
+        constexpr char report  = 0x07; // REPORT n ...: n units forwarded unchanged
+        constexpr char marquee = 0x08; // MARQUEE m: starts (1) or stops (0) the marquee mode
+        constexpr char store   = 0x09; // STORE s: saves the settings s of all modules
+        constexpr char segs    = 0x0A; // SEGS o m: shows the segments m on the module at offset o
+        constexpr char sync    = 0x0B; // SYN h: restarts the timer, h modules ago
+    }
+
+    /**
+     * The attribute codes select the effect of the characters that follow.
+     * In store-and-forward mode an attribute code applies to the rest of
+     * the message, otherwise it prefixes each character code.
+     */
+    namespace attribute {
+        constexpr char steady = 0x10; // the character is always on
+        constexpr char blink  = 0x11; // on for half the period
+        constexpr char pulse  = 0x12; // on for an eighth of the period
+        constexpr char fade   = 0x13; // the brightness rises and falls
+
+        constexpr int rate_shift = 2; // the period is 16 << rate RTC ticks
+        constexpr int max_rate = 3;
+    }
+
+    namespace store {
+        constexpr char splash     = 0x01; // the glyph shown becomes the splash glyph
+        constexpr char persist    = 0x02; // the last glyph is shown at boot
+        constexpr char no_persist = 0x04; // the splash glyph is shown at boot
+    }
+
+    namespace report {
+        constexpr char errors    = 0x01; // rx_errors, dropped (16-bit, little endian)
+        constexpr char telemetry = 0x02; // IRQ cycles, time out of IRQs, mux intervals (diagnostic builds)
+    }
+
+    /**
+     * Computes the CRC-8 (polynomial 0x07, initial value 0) checked by CHECK.
+     */
+    uint8_t crc8(uint8_t crc, const char* data, size_t size);
+
     struct options {
 		const char* input_text;
         bool raw;
+        bool command;
+        bool check;
+        bool query;
+        bool telemetry; // queries the telemetry instead of the error counters
+        bool marquee;
+        bool sync;
+        int offset;
+        int brightness;
+        int autobaud_modules; // 0 if no auto-baud is requested
+        char attribute; // 0 if no effect is selected
+        char store; // the settings to store (@see store), 0 if none
         int animation_window;
         int animation_timing_ms;
+        const char* framebuffer_name; // NULL if no framebuffer is shared
+        int framebuffer_modules;
+        bool calibrate;
+        bool monitor; // counts the messages committed, dropped or lost in the loopback
+        int end_of_message_ms;
+        long hop_latency_us; // the delay of each module, 0 for one unit
+        int modules; // the length of the chain, 0 if unknown
 
         options();
 
@@ -54,7 +126,51 @@ namespace protocol {
 
     void process(serial::buffer& output, const options& opts);
 
-    void send(serial::port& port, const options& opts);
+    /**
+     * Sends the input text, as a frame, an animation or a marquee.
+     * Returns once the last message is written, without waiting for its end.
+     * @return true if all the messages were written, false otherwise.
+     */
+    bool send(serial::port& port, const options& opts);
+
+    /**
+     * Sends the frames published in a framebuffer until stopped is set.
+     * In store-and-forward mode, only the modules changed since the
+     * previous frame are written.
+     * Each frame waits for the previous one to reach the modules,
+     * so the frames published meanwhile are merged.
+     * @return true once stopped, false if a frame could not be written.
+     */
+    bool stream(serial::port& port, framebuffer::shared& fb, const options& opts,
+            const volatile sig_atomic_t& stopped);
+
+    /**
+     * Measures the chain looped back to the serial device: its length,
+     * the delay of each module and the min gap between two messages,
+     * then tunes the pacing of the messages that follow.
+     * Requires the command mode.
+     * @return true if the chain answered, false otherwise.
+     */
+    bool calibrate(serial::port& port, options& opts);
+
+    /**
+     * Makes the modules lock onto the speed of the serial device.
+     * Each module receives a break followed by a sync field (0x55):
+     * in mirror mode, the host sends one for each module,
+     * in store-and-forward mode, each module sends one to the next.
+     * The new speed is saved by the modules.
+     * @return true if the sync fields were sent, false if a break or
+     *         a sync field could not be written.
+     */
+    bool autobaud(serial::port& port, const options& opts);
+
+    /**
+     * Queries the error counters, or the telemetry, of the modules
+     * in store-and-forward mode and prints them. Requires the TX of the last module of the chain
+     * to be looped back to the RX of the serial device.
+     * @return true if the reports were received, false otherwise.
+     */
+    bool query(serial::port& port, const options& opts);
 
 }
 
@@ -94,7 +94,8 @@ namespace serial {
 				cfsetospeed(&new_options, options.speed);
 				new_options.c_cflag |= (CLOCAL | CREAD);
 				new_options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);	// RAW mode
-				new_options.c_oflag |= (OPOST | ONLCR);
+				new_options.c_oflag &= ~OPOST;	// message units are sent untranslated
+				new_options.c_iflag &= ~(INLCR | ICRNL | IGNCR);
 
 				new_options.c_cflag &= ~CSIZE; // Mask the character size bits
 				switch (options.nbits) {
@@ -191,9 +192,9 @@ namespace serial {
 	}
 
 	ssize_t port::write(const buffer& buffer, size_t size) {
-		ssize_t written;
+		size_t written = 0;
 		do {
-			ssize_t count = ::write(device_fh, ((char*)buffer.ptr) + buffer.offset, size);
+			ssize_t count = ::write(device_fh, ((char*)buffer.ptr) + buffer.offset + written, size - written);
 			if (count == -1) return -1;
 			written += count;
 		} while (written < size);
@@ -201,4 +202,17 @@ namespace serial {
 		return size;
 	}
 
+	bool port::drain() {
+		return tcdrain(device_fh) != -1;
+	}
+
+	bool port::send_break(int ms) {
+		if (tcdrain(device_fh) == -1
+		|| ::ioctl(device_fh, TIOCSBRK) == -1) {
+			return false;
+		}
+		usleep(ms * 1000);
+		return ::ioctl(device_fh, TIOCCBRK) != -1;
+	}
+
 }
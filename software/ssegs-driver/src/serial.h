@@ -70,6 +70,10 @@ namespace serial {
 		int   size;   // max size available starting from the offset
 	};
 
+	/**
+	 * A serial device. The methods which move data are virtual,
+	 * so that other backends may take the place of the device.
+	 */
 	class port {
 		std::string    device_path;
 		int            device_fh;
@@ -78,7 +82,7 @@ namespace serial {
 
 	public:
 		port();
-		~port();
+		virtual ~port();
 
 		inline void set_path(const char* device_path) {
 			this->device_path = device_path;
@@ -96,11 +100,23 @@ namespace serial {
 			return options;
 		}
 
-		bool open();
-		void close();
+		virtual bool open();
+		virtual void close();
 
-		ssize_t read(const buffer& buffer);
-		ssize_t write(const buffer& buffer, size_t size);
+		virtual ssize_t read(const buffer& buffer);
+		virtual ssize_t write(const buffer& buffer, size_t size);
+
+		/**
+		 * Waits until all the data written is sent.
+		 * @return true if the data was sent, false otherwise.
+		 */
+		virtual bool drain();
+
+		/**
+		 * Holds the line low for a while, once all pending data is sent.
+		 * @return true if the break was sent, false otherwise.
+		 */
+		virtual bool send_break(int ms);
 
 	};
 
@@ -0,0 +1,182 @@
+/* 
+ * File:   ssegs.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <chrono>
+
+#include "ssegs.h"
+
+/* --------------------------------------------------------------------- */
+
+/**
+ * The max size of an animation window, as accepted by the driver.
+ */
+constexpr int MAX_WINDOW = 128;
+
+namespace ssegs {
+
+	client::client() {
+		port = &device;
+		running = false;
+		synced = false;
+	}
+
+	client::~client() {
+		close();
+	}
+
+	bool client::open(
+			const char* device_path,
+			const serial::options& port_options,
+			const protocol::options& protocol_options) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (running || worker.joinable()) return false;
+
+		device.set_path(device_path);
+		device.set_options(port_options);
+		return start(device, protocol_options);
+	}
+
+	bool client::open(serial::port& port, const protocol::options& protocol_options) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (running || worker.joinable()) return false;
+
+		return start(port, protocol_options);
+	}
+
+	bool client::start(serial::port& port, const protocol::options& protocol_options) {
+		if ( ! port.open()) return false;
+		this->port = &port;
+
+		defaults = protocol_options;
+		defaults.input_text = NULL;
+		defaults.marquee = false;
+		defaults.animation_window = 0;
+		defaults.store = 0;
+		defaults.framebuffer_name = NULL;
+
+		running = true;
+		synced = false;
+		worker = std::thread(&client::run, this);
+		return true;
+	}
+
+	void client::close() {
+		std::thread stopped;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if ( ! running) return;
+			running = false;
+			stopped = std::move(worker);
+		}
+		ready.notify_one();
+		stopped.join();
+		port->close();
+	}
+
+	bool client::submit_frame(const char* text, callback done) {
+		if ( ! text) return false;
+		return enqueue({ job_kind::frame, text, 0, 0, std::move(done) });
+	}
+
+	bool client::submit_scroll(const char* text, int window, int timing_ms, callback done) {
+		if ( ! text || window < 0 || window > MAX_WINDOW || timing_ms <= 0) return false;
+		return enqueue({ job_kind::scroll, text, window, timing_ms, std::move(done) });
+	}
+
+	bool client::flush(callback done) {
+		return enqueue({ job_kind::flush, std::string(), 0, 0, std::move(done) });
+	}
+
+	void client::cancel() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto& job : jobs) cancelled.push_back(std::move(job));
+			jobs.clear();
+		}
+		ready.notify_one();
+	}
+
+	bool client::enqueue(job&& job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if ( ! running) return false;
+			// the marquee mode needs the command mode, set by the last open()
+			if (job.kind == job_kind::scroll && ! job.window && ! defaults.command) return false;
+			jobs.push_back(std::move(job));
+		}
+		ready.notify_one();
+		return true;
+	}
+
+	/*
+	 * Runs the jobs in order until the client is closed and no job is left.
+	 * The cancelled jobs, queued before the others, are completed first.
+	 * The callbacks run without the lock, so that they may submit more jobs.
+	 */
+	void client::run() {
+		for (;;) {
+			job job;
+			bool discarded;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				ready.wait(lock, [this] { return ! running || ! jobs.empty() || ! cancelled.empty(); });
+				discarded = ! cancelled.empty();
+				if ( ! discarded && jobs.empty()) return;
+				auto& from = discarded ? cancelled : jobs;
+				job = std::move(from.front());
+				from.pop_front();
+			}
+
+			status result = discarded ? status::cancelled : execute(job);
+			if (job.done) job.done(result);
+		}
+	}
+
+	/*
+	 * Each message is followed by the end of message timeout,
+	 * so that the modules do not merge it with the next one.
+	 */
+	status client::execute(const job& job) {
+		if (job.kind == job_kind::flush) {
+			return port->drain() ? status::sent : status::failed;
+		}
+
+		protocol::options opts = defaults;
+		opts.input_text = job.text.c_str();
+		opts.sync = defaults.sync && ! synced;
+		if (job.kind == job_kind::scroll) {
+			opts.marquee = ! job.window;
+			opts.animation_window = job.window;
+			opts.animation_timing_ms = job.timing_ms;
+		}
+
+		bool sent = protocol::send(*port, opts) && port->drain();
+		synced = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(defaults.end_of_message_ms));
+		return sent ? status::sent : status::failed;
+	}
+
+}
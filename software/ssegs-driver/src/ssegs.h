@@ -0,0 +1,159 @@
+/* 
+ * File:   ssegs.h
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SSEGS_H_INCLUDED
+#define SSEGS_H_INCLUDED
+
+/* --------------------------------------------------------------------- */
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "protocol.h"
+#include "serial.h"
+
+/* --------------------------------------------------------------------- */
+
+/**
+ * The client library of the modules (libssegs): the updates are queued
+ * and sent in order by a thread of the client, so that submitting them
+ * never blocks on the serial device.
+ * The methods of a client may be called from any thread;
+ * the callbacks run on the thread of the client, and may submit more jobs.
+ */
+namespace ssegs {
+
+	enum class status {
+		sent,      // the messages were written to the serial device
+		failed,    // the serial device reported an error
+		cancelled  // the job was discarded before being sent
+	};
+
+	using callback = std::function<void(status)>;
+
+	class client {
+		enum class job_kind {
+			frame,
+			scroll,
+			flush
+		};
+
+		struct job {
+			job_kind    kind;
+			std::string text;
+			int         window;
+			int         timing_ms;
+			callback    done;
+		};
+
+		serial::port      device;
+		serial::port*     port; // the device, or the port given to open
+		protocol::options defaults;
+
+		std::mutex              mutex;
+		std::condition_variable ready;
+		std::deque<job>         jobs;
+		std::deque<job>         cancelled; // completed by the thread of the client
+		std::thread             worker;
+		bool                    running; // jobs are accepted
+		bool                    synced;  // the first message was sent
+
+		bool start(serial::port& port, const protocol::options& protocol_options);
+		bool enqueue(job&& job);
+		void run();
+		status execute(const job& job);
+
+	public:
+		client();
+		~client();
+
+		/**
+		 * Opens the serial device and starts the thread of the client.
+		 * The protocol options (command mode, check, effect, brightness...)
+		 * apply to all the jobs, the sync to the first one only;
+		 * their input text, animation, marquee, framebuffer and settings
+		 * to store are ignored.
+		 * @return true if the device was opened, false otherwise.
+		 */
+		bool open(const char* device_path,
+				const serial::options& port_options = serial::options(),
+				const protocol::options& protocol_options = protocol::options());
+
+		/**
+		 * Opens a port set up by the caller, such as a preview::terminal,
+		 * and starts the thread of the client.
+		 * The port must outlive the client, or its close.
+		 * @return true if the port was opened, false otherwise.
+		 */
+		bool open(serial::port& port,
+				const protocol::options& protocol_options = protocol::options());
+
+		/**
+		 * Sends the pending jobs, then closes the serial device.
+		 * Not to be called from a callback.
+		 */
+		void close();
+
+		/**
+		 * Queues a text to show at once.
+		 * @return true if the job was queued, false if the client is closed
+		 * or text is null.
+		 */
+		bool submit_frame(const char* text, callback done = nullptr);
+
+		/**
+		 * Queues a text to scroll through a window of modules,
+		 * one frame every timing_ms, or to shift into the chain
+		 * with the marquee mode if window is 0 (requires the command mode).
+		 * @return true if the job was queued, false if the client is closed,
+		 * text is null or the job is invalid.
+		 */
+		bool submit_scroll(const char* text, int window, int timing_ms, callback done = nullptr);
+
+		/**
+		 * Queues a callback, called once the jobs queued before it
+		 * are sent and the modules have received them.
+		 * @return true if the callback was queued, false if the client is closed.
+		 */
+		bool flush(callback done);
+
+		/**
+		 * Discards the jobs not yet started. Their callbacks are called
+		 * with status::cancelled on the thread of the client, before
+		 * the ones of the jobs submitted afterwards.
+		 */
+		void cancel();
+	};
+
+}
+
+/* --------------------------------------------------------------------- */
+
+#endif /* SSEGS_H_INCLUDED */
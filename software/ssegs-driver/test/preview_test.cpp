@@ -0,0 +1,155 @@
+/* 
+ * File:   preview_test.cpp
+ * Author: Gabriele Falcioni <foss.dev@falcioni.net>
+ *
+ * Copyright 2022 Gabriele Falcioni
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+/*
+ * Checks that the preview decodes the frames of the mirror mode as the
+ * firmware does: each case is sent both to a preview and to the chain
+ * test bench of the firmware (firmware/host), which runs the real modules,
+ * and the glyphs they end up showing are compared.
+ * The attributes are steady, since the test bench samples the segments lit.
+ * Usage: preview_test CHAIN LIBRARY
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "display.hpp"
+#include "preview.h"
+
+/* --------------------------------------------------------------------- */
+
+constexpr int MODULES = 6;
+
+struct test_case {
+	const char* name;
+	std::vector<std::vector<uint8_t>> frames;
+};
+
+static const test_case cases[] = {
+	{ "text", { { 'H', 'E', 'L', 'L', 'O' } } },
+	{ "prefixes", { { 0x10, 'A', 0x14, 'B', 'C', 0x1C, 'D' } } },
+	{ "prefixed prefix", { { 0x10, 0x14, 'A', 'B' } } },
+	{ "sync", { { 'A', 'B', 'C', 'D' }, { 'E', 0x0B, 'F' } } },
+	{ "sync at the end", { { 'A', 'B', 'C', 'D', 'E', 'F' }, { 'G', 'H', 0x0B } } },
+	{ "codes", { { 0x01, 0x02, 0x0A, 0x0C, 0x14, 'A' } } },
+};
+
+/*
+ * Prints a glyph as the test bench does: the first character
+ * with the same segments, with or without the decimal point.
+ */
+static void print_glyph(std::string& output, uint8_t segments) {
+	static const char codes[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+		"-_=\"'()[]{}<>/\\|!?.,:;+*#$%&@^`~";
+
+	if ( ! segments) {
+		output += ' ';
+		return;
+	}
+	for (const char* p = codes; *p; ++p) {
+		if (display::char_to_segs(*p) == segments) {
+			output += *p;
+			return;
+		}
+		if (display::char_to_segs(*p | 0x80) == segments) {
+			output += *p;
+			output += '.';
+			return;
+		}
+	}
+	char hex[8];
+	snprintf(hex, sizeof(hex), "[%02x]", segments);
+	output += hex;
+}
+
+static std::string preview_display(const test_case& test) {
+	preview::terminal terminal;
+	terminal.set_chain(MODULES, false);
+	for (const auto& frame : test.frames) {
+		serial::buffer buffer = { (void*)frame.data(), 0, (int)frame.size() };
+		terminal.write(buffer, frame.size());
+	}
+
+	std::string output = "|";
+	for (int i = 0; i < MODULES; ++i) print_glyph(output, terminal.get_segments(i));
+	return output + "|";
+}
+
+/*
+ * Gets the last display printed by the test bench, after the last frame.
+ */
+static std::string chain_display(const test_case& test, const char* chain, const char* library) {
+	char path[] = "/tmp/preview_test.XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) return "";
+	FILE* input = fdopen(fd, "w");
+	for (const auto& frame : test.frames) {
+		for (uint8_t unit : frame) fprintf(input, "%02X ", unit);
+		fputc('\n', input);
+	}
+	fclose(input);
+
+	std::string command = std::string(chain) + " -n " + std::to_string(MODULES)
+		+ " -l " + library + " < " + path;
+	FILE* output = popen(command.c_str(), "r");
+	std::string display;
+	char line[1024];
+	while (output && fgets(line, sizeof(line), output)) {
+		const char* start = strstr(line, "display:");
+		if ( ! start || ! (start = strchr(start, '|'))) continue;
+		const char* end = strrchr(line, '|');
+		display.assign(start, end + 1);
+	}
+	if (output) pclose(output);
+	unlink(path);
+	return display;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s CHAIN LIBRARY\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int failures = 0;
+	for (const test_case& test : cases) {
+		std::string expected = chain_display(test, argv[1], argv[2]);
+		std::string actual = preview_display(test);
+		if (actual == expected) {
+			printf("PASS %s %s\n", test.name, actual.c_str());
+		} else {
+			printf("FAIL %s: chain %s, preview %s\n", test.name, expected.c_str(), actual.c_str());
+			++failures;
+		}
+	}
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}